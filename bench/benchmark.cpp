@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/solver.h"
+#include "perfcounters.h"
+
+// Benchmark the solver on the standard test sets and report, for each set, the mean time and nodes per position,
+//  the node rate, the number of correctly solved positions and the quality of the move ordering: the share of beta
+//  cutoffs caused by the first move searched and the mean number of moves searched per cutoff. Every position is solved
+//  with an empty table and no move ordering history.
+//
+// With -c, hardware performance counters are read around every solve and reported per node: cycles, instructions, L1 data
+//  cache and last level cache misses, data TLB misses and branch mispredictions. These are far steadier than times on a
+//  shared host. Counters the host does not provide are shown as "-". With more than one thread, the counts include the
+//  helper threads, and the calling thread is also counted alone to check it: a set where the helpers account for almost
+//  none of the instructions gets a warning, as its counts per node would then be those of one thread spread over the
+//  nodes of all of them.
+// With -S, the mean nodes and the counters per node of each set are saved to a baseline file, one "set metric value" per line.
+//  With -B, they are compared against a baseline file instead, and the exit code is 1 if any of them is more than the
+//  threshold (-r, 5% by default) above its baseline. Metrics missing from either side are not compared.
+//
+// The sets follow the naming of Pascal Pons' Test_L<depth>_R<difficulty> files. Each line is "moves score".
+//  L3: more than 28 moves played. L2: 15 to 28 moves played. L1: 11 to 14 moves played, as earlier positions take
+//  far too long to generate and benchmark.
+//  R1: the game ends less than 14 moves from now with perfect play. R2: in 14 to 27 moves. R3: in 28 moves or more.
+//
+// Usage:
+//  benchmark [-t threads] [-m MB] [-w] [-n max positions per set] [-d data dir] [-j json file] [-l label]
+//            [-c] [-S baseline] [-B baseline] [-r percent] [set...]
+//  benchmark -g set count seed    Generate count positions of a set with random play and print them.
+
+#ifndef IBN5100_BENCH_DATA
+#define IBN5100_BENCH_DATA "bench/data"
+#endif
+
+using namespace IBN5100;
+
+struct TestSet {
+    char const* name;
+    char const* description;
+    int minMoves, maxMoves; // range of moves played
+    int minRemaining, maxRemaining; // range of moves left until the end of the game with perfect play
+};
+
+static constexpr TestSet testSets[] = {
+    {"Test_L3_R1", "End-Easy",      29, 42,  0, 13},
+    {"Test_L2_R1", "Middle-Easy",   15, 28,  0, 13},
+    {"Test_L2_R2", "Middle-Medium", 15, 28, 14, 27},
+    {"Test_L1_R1", "Begin-Easy",    11, 14,  0, 13},
+    {"Test_L1_R2", "Begin-Medium",  11, 14, 14, 27},
+    {"Test_L1_R3", "Begin-Hard",    11, 14, 28, 42},
+};
+
+// Get the number of moves left until the end of the game when both players play perfectly.
+static int remainingMoves(int moves, int score) {
+    if (!score) { return 42 - moves; }
+
+    // A player winning with the score s places their last piece as the k-th piece of the game, where (44 - k)/2 = s.
+    // The winner's pieces are the ones with the parity of moves + 1 when the current player wins, moves otherwise.
+    int s = score > 0 ? score : -score;
+    int parity = score > 0 ? (moves + 1)%2 : moves%2;
+    int k = (44 - 2*s)%2 == parity ? 44 - 2*s : 43 - 2*s;
+
+    return k - moves;
+}
+
+static int generate(TestSet const &set, int count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    Solver solver;
+
+    for (int found = 0; found < count;) {
+        int length = set.minMoves + rng()%(set.maxMoves - set.minMoves + 1);
+        std::string moves;
+        Position pos;
+
+        // Play random moves, never finishing the game.
+        while ((int) moves.length() < length) {
+            int c = rng()%7;
+            if (!pos.canPlay(c) || pos.isWin(c)) { continue; }
+
+            pos.playCol(c);
+            moves += '1' + c;
+            if (pos.canWinNext() || pos.getMoves() == 42) { break; }
+        }
+
+        if ((int) moves.length() != length || pos.canWinNext()) { continue; }
+
+        solver.reset();
+        int score = solver.solve(pos);
+        int remaining = remainingMoves(pos.getMoves(), score);
+
+        if (remaining < set.minRemaining || remaining > set.maxRemaining) { continue; }
+
+        std::printf("%s %d\n", moves.c_str(), score);
+        std::fflush(stdout);
+        ++found;
+    }
+
+    return 0;
+}
+
+// Quote a string as a JSON string, escaping the characters that would end it or break the document.
+static std::string jsonString(std::string const &s) {
+    std::string quoted = "\"";
+
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if ((unsigned char) c < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            quoted += buffer;
+        } else { quoted += c; }
+    }
+
+    return quoted + '"';
+}
+
+// Metrics of every set by set name and metric name, all of which are better when lower.
+typedef std::map<std::string, std::map<std::string, double>> Metrics;
+
+static bool saveBaseline(std::string const &filename, Metrics const &metrics) {
+    std::ofstream out(filename);
+    out.precision(12);
+
+    for (auto const &[set, values] : metrics) {
+        for (auto const &[metric, value] : values) { out << set << ' ' << metric << ' ' << value << '\n'; }
+    }
+
+    return (bool) out;
+}
+
+// Print the change of every metric from the baseline and return whether any of them regressed past the threshold.
+static bool compareBaseline(std::string const &filename, Metrics const &metrics, double threshold) {
+    std::ifstream in(filename);
+
+    if (!in.is_open()) {
+        std::fprintf(stderr, "Could not open %s\n", filename.c_str());
+        return 1;
+    }
+
+    Metrics baseline;
+    std::string set, metric;
+    for (double value; in >> set >> metric >> value;) { baseline[set][metric] = value; }
+
+    bool regressed = 0;
+    std::printf("\n%-12s %-18s %14s %14s %9s\n", "set", "metric", "baseline", "current", "change");
+
+    for (auto const &[set, values] : metrics) {
+        auto base = baseline.find(set);
+        if (base == baseline.end()) { continue; }
+
+        for (auto const &[metric, value] : values) {
+            auto it = base->second.find(metric);
+            if (it == base->second.end() || it->second <= 0) { continue; }
+
+            double change = 100*(value/it->second - 1);
+            bool regression = change > threshold;
+            regressed |= regression;
+
+            std::printf("%-12s %-18s %14.4f %14.4f %8.2f%%%s\n", set.c_str(), metric.c_str(), it->second, value, change,
+                regression ? "  REGRESSION" : "");
+        }
+    }
+
+    return regressed;
+}
+
+int main(int argc, char** argv) {
+    unsigned int numThreads = 1;
+    size_t tableBytes = TransposeTable::defaultBytes;
+    bool weak = 0, counters = 0;
+    size_t limit = SIZE_MAX;
+    double threshold = 5;
+    std::string dataDir = IBN5100_BENCH_DATA, jsonFile, label, saveFile, compareFile;
+    std::vector<std::string> selected;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-t" && i + 1 < argc) { numThreads = std::stoi(argv[++i]); }
+        else if (arg == "-m" && i + 1 < argc) { tableBytes = std::stoull(argv[++i]) << 20; }
+        else if (arg == "-w") { weak = 1; }
+        else if (arg == "-n" && i + 1 < argc) { limit = std::stoull(argv[++i]); }
+        else if (arg == "-d" && i + 1 < argc) { dataDir = argv[++i]; }
+        else if (arg == "-j" && i + 1 < argc) { jsonFile = argv[++i]; }
+        else if (arg == "-l" && i + 1 < argc) { label = argv[++i]; }
+        else if (arg == "-c") { counters = 1; }
+        else if (arg == "-S" && i + 1 < argc) { saveFile = argv[++i]; }
+        else if (arg == "-B" && i + 1 < argc) { compareFile = argv[++i]; }
+        else if (arg == "-r" && i + 1 < argc) { threshold = std::stod(argv[++i]); }
+        else if (arg == "-g" && i + 3 < argc) {
+            for (TestSet const &set : testSets) {
+                if (set.name == std::string(argv[i + 1])) { return generate(set, std::stoi(argv[i + 2]), std::stoul(argv[i + 3])); }
+            }
+
+            std::fprintf(stderr, "Unknown set %s\n", argv[i + 1]);
+            return 1;
+        }
+        else { selected.push_back(arg); }
+    }
+
+    // The counters are opened before the solver starts its helper threads, which they could not count otherwise.
+    PerfCounters perf, mainThread(0);
+    Solver solver(nullptr, numThreads, tableBytes);
+    Metrics metrics;
+
+    bool helpers = counters && solver.getNumThreads() > 1; // check that the counters include the helper threads
+
+    if (counters && !perf.anyAvailable()) { std::fprintf(stderr, "No hardware performance counters are available on this host\n"); }
+    if (counters && perf.missesThreads()) { std::fprintf(stderr, "The performance counters were opened after other threads were started and miss them\n"); }
+
+    std::string json = "{\"label\": " + jsonString(label) + ", \"threads\": " + std::to_string(solver.getNumThreads()) +
+        ", \"tableBytes\": " + std::to_string(solver.getTransTable().getBytes()) + ", \"weak\": " + (weak ? "true" : "false") + ", \"sets\": [";
+    bool failed = 0, first = 1;
+
+    std::printf("%-12s %-14s %9s %9s %14s %14s %12s %11s %11s\n", "set", "", "positions", "correct", "mean time(us)", "mean nodes", "knodes/s",
+        "first cut%", "moves/cut");
+
+    for (TestSet const &set : testSets) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), set.name) == selected.end()) { continue; }
+
+        std::ifstream f(dataDir + "/" + set.name);
+        if (!f.is_open()) {
+            std::fprintf(stderr, "Could not open %s/%s\n", dataDir.c_str(), set.name);
+            failed = 1;
+            continue;
+        }
+
+        size_t positions = 0, correct = 0;
+        uint64_t nodes = 0;
+        OrderingStats ordering;
+        double elapsed = 0;
+
+        std::string moves;
+        int expected;
+
+        perf.reset();
+        mainThread.reset();
+
+        while (positions < limit && f >> moves >> expected) {
+            Position pos;
+            if (pos.init(moves) != moves.length()) { continue; }
+
+            solver.reset();
+
+            if (counters) { perf.start(); }
+            if (helpers) { mainThread.start(); }
+            auto start = std::chrono::steady_clock::now();
+            int score = solver.solve(pos, weak);
+            elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (helpers) { mainThread.stop(); }
+            if (counters) { perf.stop(); }
+            nodes += solver.getNodeCount();
+
+            OrderingStats stats = solver.getOrderingStats();
+            ordering.cutoffs += stats.cutoffs;
+            ordering.firstMoveCutoffs += stats.firstMoveCutoffs;
+            ordering.cutoffMoves += stats.cutoffMoves;
+
+            correct += weak ? (score > 0) - (score < 0) == (expected > 0) - (expected < 0) : score == expected;
+            ++positions;
+        }
+
+        if (!positions) { continue; }
+
+        double meanTime = elapsed/positions*1e6, meanNodes = (double) nodes/positions, rate = nodes/elapsed;
+        double firstCut = ordering.cutoffs ? 100.0*ordering.firstMoveCutoffs/ordering.cutoffs : 0;
+        double movesPerCut = ordering.cutoffs ? (double) ordering.cutoffMoves/ordering.cutoffs : 0;
+        failed |= correct != positions;
+
+        std::printf("%-12s %-14s %9zu %9zu %14.1f %14.1f %12.0f %11.2f %11.3f\n", set.name, set.description, positions, correct, meanTime,
+            meanNodes, rate/1000, firstCut, movesPerCut);
+        std::fflush(stdout);
+
+        char buffer[512];
+        std::snprintf(buffer, sizeof(buffer), "%s\n    {\"name\": \"%s\", \"description\": \"%s\", \"positions\": %zu, \"correct\": %zu, "
+            "\"meanTimeUs\": %.3f, \"meanNodes\": %.3f, \"nodesPerSecond\": %.0f, \"firstMoveCutoffPercent\": %.3f, \"movesPerCutoff\": %.4f",
+            first ? "" : ",", set.name, set.description, positions, correct, meanTime, meanNodes, rate, firstCut, movesPerCut);
+        json += buffer;
+        first = 0;
+
+        metrics[set.name]["nodes"] = meanNodes;
+
+        for (int e = 0; counters && e < PerfCounters::NUM_EVENTS; ++e) {
+            double count = perf.read((PerfCounters::Event) e);
+            if (count < 0) { continue; }
+
+            std::string metric = std::string(PerfCounters::names[e]) + "PerNode";
+            metrics[set.name][metric] = count/nodes;
+
+            std::snprintf(buffer, sizeof(buffer), ", \"%s\": %.4f", metric.c_str(), count/nodes);
+            json += buffer;
+        }
+
+        double all = helpers ? perf.read(PerfCounters::INSTRUCTIONS) : -1, alone = mainThread.read(PerfCounters::INSTRUCTIONS);
+
+        if (all > 0 && alone >= 0) {
+            // Below 1%, the helpers cannot have searched their share of the nodes, so their events were likely not counted.
+            double share = std::max(100*(1 - alone/all), 0.0);
+            if (share < 1) { std::fprintf(stderr, "The helper threads ran only %.2f%% of the instructions counted for %s\n", share, set.name); }
+
+            std::snprintf(buffer, sizeof(buffer), ", \"helperInstructionPercent\": %.2f", share);
+            json += buffer;
+        }
+
+        json += "}";
+    }
+
+    json += "\n]}\n";
+
+    if (counters) {
+        std::printf("\n%-12s %12s %12s %8s %12s %12s %12s %12s\n", "per node", "cycles", "instructions", "IPC", "L1D misses", "LLC misses",
+            "dTLB misses", "br. misses");
+
+        for (TestSet const &set : testSets) {
+            auto found = metrics.find(set.name);
+            if (found == metrics.end()) { continue; }
+
+            std::map<std::string, double> const &values = found->second;
+            std::printf("%-12s", set.name);
+
+            auto print = [&](std::string const &metric, int width) {
+                auto it = values.find(metric);
+                if (it == values.end()) { std::printf(" %*s", width, "-"); }
+                else { std::printf(" %*.3f", width, it->second); }
+            };
+
+            print("cyclesPerNode", 12);
+            print("instructionsPerNode", 12);
+
+            auto cycles = values.find("cyclesPerNode"), instructions = values.find("instructionsPerNode");
+            if (cycles == values.end() || instructions == values.end() || !cycles->second) { std::printf(" %8s", "-"); }
+            else { std::printf(" %8.2f", instructions->second/cycles->second); }
+
+            print("l1dMissesPerNode", 12);
+            print("llcMissesPerNode", 12);
+            print("dtlbMissesPerNode", 12);
+            print("branchMissesPerNode", 12);
+            std::printf("\n");
+        }
+    }
+
+    if (!saveFile.empty() && !saveBaseline(saveFile, metrics)) {
+        std::fprintf(stderr, "Could not write %s\n", saveFile.c_str());
+        failed = 1;
+    }
+
+    if (!compareFile.empty()) { failed |= compareBaseline(compareFile, metrics, threshold); }
+
+    if (!jsonFile.empty()) {
+        std::ofstream out(jsonFile);
+        out << json;
+    }
+
+    return failed;
+};
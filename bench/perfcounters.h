@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace IBN5100 {
+    /**
+     * @brief Hardware performance counters of the calling thread and the threads it starts afterwards, read with
+     *  perf_event_open.
+     * Threads that already exist when the counters are opened are never counted, so they must be opened before a
+     *  multithreaded Solver is constructed, as its helper threads are started by the constructor and live as long as it.
+     * Only user space events are counted, and only between calls to start and stop, so the counts can be accumulated over
+     *  the parts of a benchmark that are being measured. Counters the kernel or the CPU does not provide, as is common in
+     *  virtual machines and containers, are reported as unavailable instead of failing.
+     *
+     */
+    class PerfCounters {
+        public:
+            enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_EVENTS };
+
+            static constexpr char const* names[NUM_EVENTS] = {"cycles", "instructions", "l1dMisses", "llcMisses", "dtlbMisses", "branchMisses"};
+
+        private:
+            int fds[NUM_EVENTS];
+            bool missedThreads; // other threads of the process were running when the counters were opened
+
+            static constexpr uint64_t cacheEvent(uint64_t cache, uint64_t op, uint64_t result) { return cache | op << 8 | result << 16; };
+
+            // The number of threads of the process, or 0 if it cannot be read.
+            static int countThreads() {
+                DIR* dir = opendir("/proc/self/task");
+                if (!dir) { return 0; }
+
+                int n = 0;
+                while (dirent* entry = readdir(dir)) { n += entry->d_name[0] != '.'; }
+
+                closedir(dir);
+                return n;
+            };
+
+            static int open(uint32_t type, uint64_t config, bool inherit) {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.type = type;
+                attr.size = sizeof(attr);
+                attr.config = config;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.inherit = inherit; // only covers threads started after this
+
+                // The counters are not grouped, so the kernel may multiplex them. The times enabled and running are read
+                //  along with each count to scale it back up.
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            };
+
+        public:
+            /**
+             * @brief Open the counters, stopped and at 0.
+             *
+             * @param threads (bool) 1 to also count the threads the calling thread starts from now on, 0 to count it alone.
+             */
+            inline explicit PerfCounters(bool threads = 1) : missedThreads{threads && countThreads() > 1} {
+                fds[CYCLES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, threads);
+                fds[INSTRUCTIONS] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, threads);
+                fds[L1D_MISSES] = open(PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), threads);
+                fds[LLC_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, threads);
+                fds[DTLB_MISSES] = open(PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), threads);
+                fds[BRANCH_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, threads);
+            };
+
+            inline ~PerfCounters() {
+                for (int fd : fds) {
+                    if (fd >= 0) { close(fd); }
+                }
+            };
+
+            PerfCounters(PerfCounters const&) = delete;
+            PerfCounters &operator =(PerfCounters const&) = delete;
+
+            inline bool available(Event e) const { return fds[e] >= 0; };
+
+            // Whether threads other than the calling one were already running when the counters were opened, so that their
+            //  events are missing from the counts.
+            inline bool missesThreads() const { return missedThreads; };
+
+            inline bool anyAvailable() const {
+                for (int fd : fds) {
+                    if (fd >= 0) { return 1; }
+                }
+
+                return 0;
+            };
+
+            inline void start() {
+                for (int fd : fds) {
+                    if (fd >= 0) { ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+                }
+            };
+
+            inline void stop() {
+                for (int fd : fds) {
+                    if (fd >= 0) { ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); }
+                }
+            };
+
+            // Set every count back to 0.
+            inline void reset() {
+                for (int fd : fds) {
+                    if (fd >= 0) { ioctl(fd, PERF_EVENT_IOC_RESET, 0); }
+                }
+            };
+
+            /**
+             * @brief Read the count of an event since the last reset.
+             *
+             * @param e (Event) The event to read.
+             * @return (double) The count, scaled up if the counter only ran part of the time. -1 if the event is unavailable.
+             */
+            inline double read(Event e) const {
+                if (fds[e] < 0) { return -1; }
+
+                uint64_t values[3]; // count, time enabled, time running
+                if (::read(fds[e], values, sizeof(values)) != (ssize_t) sizeof(values)) { return -1; }
+
+                // A counter that was enabled but never scheduled has no meaningful count.
+                if (!values[2]) { return values[1] ? -1 : 0; }
+                return (double) values[0]*values[1]/values[2];
+            };
+    };
+}
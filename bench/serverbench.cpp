@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../include/solverserver.h"
+
+// Load generator for a running server. Each connection keeps a fixed number of requests in flight, sending the next one
+//  as soon as a response arrives, and the latency of every request is measured from the moment it is sent until its
+//  response is read. Reports the throughput, the latency percentiles and, from the responses, the mean time requests
+//  spent queued and solving. Solve scores are checked against the expected scores of the test sets.
+// Positions are taken in turn from the given test sets, Test_L3_R1 and Test_L2_R1 by default.
+// Usage: serverbench [-c connections] [-p requests in flight per connection] [-n requests] [-a] [-d data dir] socket [set...]
+
+#ifndef IBN5100_BENCH_DATA
+#define IBN5100_BENCH_DATA "bench/data"
+#endif
+
+using namespace IBN5100;
+
+struct Request {
+    std::string moves;
+    int expected;
+};
+
+struct ConnectionResult {
+    std::vector<double> latencies; // in microseconds
+    double waitTime = 0, solveTime = 0; // in microseconds, as reported by the server
+    uint64_t failed = 0;
+    bool error = 0;
+};
+
+static void runConnection(std::string const &socketPath, std::vector<Request> const &requests, size_t first, size_t count,
+    int depth, bool analyze, ConnectionResult &result) {
+    int fd = connectUnix(socketPath);
+
+    if (fd < 0) {
+        result.error = 1;
+        return;
+    }
+
+    std::vector<std::chrono::steady_clock::time_point> sent(count);
+    size_t numSent = 0, numReceived = 0;
+
+    auto send = [&] {
+        std::string line = (analyze ? "analyze " : "solve ") + requests[(first + numSent) % requests.size()].moves + "\n";
+        sent[numSent++] = std::chrono::steady_clock::now();
+        return write(fd, line.data(), line.size()) == (ssize_t) line.size();
+    };
+
+    while (numSent < count && numSent < (size_t) depth) {
+        if (!send()) { result.error = 1; }
+    }
+
+    std::string buffer;
+    char chunk[4096];
+
+    while (numReceived < count && !result.error) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+
+        if (n <= 0) {
+            result.error = 1;
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        buffer.append(chunk, n);
+
+        size_t start = 0;
+        for (size_t end; (end = buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+            std::istringstream ss(buffer.substr(start, end - start));
+            std::vector<std::string> fields;
+            for (std::string field; ss >> field;) { fields.push_back(field); }
+
+            if (fields.size() < 5) {
+                result.error = 1;
+                break;
+            }
+
+            size_t index = std::stoull(fields[0]);
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(now - sent[index]).count());
+            result.waitTime += std::stod(fields[fields.size() - 2]);
+            result.solveTime += std::stod(fields.back());
+            if (!analyze && std::stoi(fields[1]) != requests[(first + index) % requests.size()].expected) { ++result.failed; }
+
+            ++numReceived;
+            if (numSent < count && !send()) { result.error = 1; }
+        }
+
+        buffer.erase(0, start);
+    }
+
+    close(fd);
+};
+
+int main(int argc, char** argv) {
+    int numConnections = 1, depth = 1;
+    size_t numRequests = 1000;
+    bool analyze = 0;
+    std::string dataDir = IBN5100_BENCH_DATA, socketPath;
+    std::vector<std::string> sets;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-c" && i + 1 < argc) { numConnections = std::max(std::stoi(argv[++i]), 1); }
+        else if (arg == "-p" && i + 1 < argc) { depth = std::max(std::stoi(argv[++i]), 1); }
+        else if (arg == "-n" && i + 1 < argc) { numRequests = std::stoull(argv[++i]); }
+        else if (arg == "-a") { analyze = 1; }
+        else if (arg == "-d" && i + 1 < argc) { dataDir = argv[++i]; }
+        else if (arg[0] == '-') {
+            std::fprintf(stderr, "Usage: %s [-c connections] [-p requests in flight per connection] [-n requests] [-a] [-d data dir] socket [set...]\n", argv[0]);
+            return 1;
+        } else if (socketPath.empty()) { socketPath = arg; }
+        else { sets.push_back(arg); }
+    }
+
+    if (socketPath.empty()) {
+        std::fprintf(stderr, "No socket given\n");
+        return 1;
+    }
+
+    if (sets.empty()) { sets = {"Test_L3_R1", "Test_L2_R1"}; }
+
+    // Interleave the sets so that every connection gets a similar mix of positions.
+    std::vector<std::vector<Request>> setRequests;
+
+    for (std::string const &set : sets) {
+        std::ifstream f(dataDir + "/" + set);
+
+        if (!f.is_open()) {
+            std::fprintf(stderr, "Could not open %s/%s\n", dataDir.c_str(), set.c_str());
+            return 1;
+        }
+
+        setRequests.emplace_back();
+        for (Request r; f >> r.moves >> r.expected;) { setRequests.back().push_back(r); }
+    }
+
+    std::vector<Request> requests;
+    for (size_t i = 0; requests.size() < numRequests; ++i) {
+        for (std::vector<Request> const &set : setRequests) {
+            if (!set.empty()) { requests.push_back(set[i % set.size()]); }
+        }
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<ConnectionResult> results(numConnections);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < numConnections; ++i) {
+        size_t first = numRequests*i/numConnections, count = numRequests*(i + 1)/numConnections - first;
+        threads.emplace_back(runConnection, std::cref(socketPath), std::cref(requests), first, count, depth, analyze, std::ref(results[i]));
+    }
+
+    for (std::thread &t : threads) { t.join(); }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> latencies;
+    double waitTime = 0, solveTime = 0;
+    uint64_t failed = 0;
+    bool error = 0;
+
+    for (ConnectionResult const &r : results) {
+        latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+        waitTime += r.waitTime;
+        solveTime += r.solveTime;
+        failed += r.failed;
+        error |= r.error;
+    }
+
+    if (error) { std::fprintf(stderr, "Some connections failed, the results only cover the %zu responses received\n", latencies.size()); }
+    if (latencies.empty()) { return 1; }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[std::min((size_t) (p*latencies.size()), latencies.size() - 1)]; };
+
+    size_t n = latencies.size();
+    std::printf("%zu requests over %d connections with %d in flight each: %.3fs, %.1f requests/s\n", n, numConnections, depth, elapsed, n/elapsed);
+    std::printf("latency: p50 %.0fus, p90 %.0fus, p99 %.0fus, max %.0fus\n", percentile(0.5), percentile(0.9), percentile(0.99), latencies.back());
+    std::printf("server: mean %.0fus queued, %.0fus solving\n", waitTime/n, solveTime/n);
+    if (failed) { std::printf("%llu responses did not match their expected score\n", (unsigned long long) failed); }
+
+    return error || failed;
+};
@@ -0,0 +1,159 @@
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "../include/solver.h"
+
+// Check every board size the library is built for against a plain alpha-beta search on random positions.
+// For each size, positions are played out at random until they have a random number of empty cells, up to the given maximum,
+//  and solved strongly, weakly and move by move with analyze. The reference search has no table, move ordering or threat
+//  analysis, so it only agrees with the solver if every one of those is correct for the size. Prints one line per size and
+//  every mismatch, and exits with 1 if there is any.
+// Usage: sizecheck [-n positions per size] [-e max empty cells] [-s seed] [-t threads]
+
+using namespace IBN5100;
+
+// Exact score of a position by a negamax search of every move in column order.
+template<int width, int height>
+static int reference(BasicPosition<width, height> const &pos, int alpha, int beta) {
+    typedef BasicPosition<width, height> Position;
+
+    int moves = pos.getMoves();
+    if (moves == Position::cells) { return 0; }
+
+    for (int c = 0; c < width; ++c) {
+        if (pos.canPlay(c) && pos.isWin(c)) { return (Position::cells + 1 - moves)/2; }
+    }
+
+    int max = (Position::cells - 1 - moves)/2;
+
+    if (beta > max) {
+        beta = max;
+        if (alpha >= beta) { return beta; }
+    }
+
+    for (int c = 0; c < width; ++c) {
+        if (!pos.canPlay(c)) { continue; }
+
+        Position pos2(pos);
+        pos2.playCol(c);
+
+        int score = -reference(pos2, -beta, -alpha);
+
+        if (score >= beta) { return score; }
+        if (alpha < score) { alpha = score; }
+    }
+
+    return alpha;
+}
+
+template<int width, int height>
+static int exactScore(BasicPosition<width, height> const &pos) {
+    typedef BasicPosition<width, height> Position;
+    return reference(pos, -Position::cells, Position::cells);
+}
+
+static int sign(int score) { return (score > 0) - (score < 0); }
+
+// Check random positions of one board size and return the number of mismatches.
+template<int width, int height>
+static int check(int positions, int maxEmpty, unsigned int numThreads, std::mt19937 &rng) {
+    typedef BasicPosition<width, height> Position;
+    typedef BasicSolver<width, height> Solver;
+
+    Solver solver(nullptr, numThreads, 16 << 20);
+    int mismatches = 0;
+
+    for (int i = 0; i < positions; ++i) {
+        int empty = 1 + rng()%maxEmpty;
+
+        // Play random moves that do not win, so that the game is still going once the position has the chosen number
+        //  of empty cells. Start over if every move left would win.
+        Position pos;
+        std::string seq;
+
+        while (Position::cells - pos.getMoves() > empty) {
+            int playable[width], n = 0;
+
+            for (int c = 0; c < width; ++c) {
+                if (pos.canPlay(c) && !pos.isWin(c)) { playable[n++] = c; }
+            }
+
+            if (!n) {
+                pos = Position();
+                seq.clear();
+                continue;
+            }
+
+            int c = playable[rng()%n];
+            pos.playCol(c);
+            seq += '1' + c;
+        }
+
+        solver.reset();
+
+        int expected = exactScore(pos);
+        int score = solver.solve(pos);
+        int weak = solver.solve(pos, 1);
+
+        if (score != expected || sign(weak) != sign(expected)) {
+            std::printf("%dx%d %s: solve %d, weak %d, expected %d\n", width, height, seq.c_str(), score, weak, expected);
+            ++mismatches;
+            continue;
+        }
+
+        std::array<int, width> scores = solver.analyze(pos);
+
+        for (int c = 0; c < width; ++c) {
+            int expectedMove = Solver::invalidMove;
+
+            if (pos.canPlay(c)) {
+                Position pos2(pos);
+                pos2.playCol(c);
+                expectedMove = pos.isWin(c) ? (Position::cells + 1 - pos.getMoves())/2 : -exactScore(pos2);
+            }
+
+            if (scores[c] != expectedMove) {
+                std::printf("%dx%d %s: analyze column %d %d, expected %d\n", width, height, seq.c_str(), c + 1, scores[c], expectedMove);
+                ++mismatches;
+                break;
+            }
+        }
+    }
+
+    std::printf("%dx%d: %d positions, %d mismatches\n", width, height, positions, mismatches);
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    int positions = 50, maxEmpty = 20;
+    unsigned int seed = 5100, numThreads = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-n" && i + 1 < argc) { positions = std::stoi(argv[++i]); }
+        else if (arg == "-e" && i + 1 < argc) { maxEmpty = std::stoi(argv[++i]); }
+        else if (arg == "-s" && i + 1 < argc) { seed = std::stoul(argv[++i]); }
+        else if (arg == "-t" && i + 1 < argc) { numThreads = std::stoi(argv[++i]); }
+        else {
+            std::fprintf(stderr, "Usage: %s [-n positions per size] [-e max empty cells] [-s seed] [-t threads]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (positions < 0 || maxEmpty < 1) {
+        std::fprintf(stderr, "There must be at least 1 empty cell\n");
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    int mismatches = 0;
+
+    mismatches += check<7, 6>(positions, maxEmpty, numThreads, rng);
+    mismatches += check<6, 5>(positions, maxEmpty, numThreads, rng);
+    mismatches += check<6, 7>(positions, maxEmpty, numThreads, rng);
+    mismatches += check<8, 7>(positions, maxEmpty, numThreads, rng);
+
+    return mismatches ? 1 : 0;
+};
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/solver.h"
+
+// Benchmark the solver's node rate against the size of the transposition table and the kind of pages backing it.
+// Every position of the given test files (one "moves [score]" line per position) is solved with a fresh table.
+// Usage: tablebench [-s MB,MB,...] file...
+
+using namespace IBN5100;
+
+static char const* pagesName(Pages pages) {
+    return pages == Pages::Small ? "small" : pages == Pages::Transparent ? "transparent" : "huge";
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {16, 64, 256, 1024};
+    std::vector<Position> positions;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-s" && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream ss(argv[++i]);
+            for (std::string mb; std::getline(ss, mb, ',');) { sizes.push_back(std::stoull(mb)); }
+            continue;
+        }
+
+        std::ifstream f(arg);
+        if (!f.is_open()) {
+            std::fprintf(stderr, "Could not open %s\n", arg.c_str());
+            return 1;
+        }
+
+        for (std::string line; std::getline(f, line);) {
+            std::string moves = line.substr(0, line.find(' '));
+            Position pos;
+            if (moves.empty() || pos.init(moves) != moves.length()) { continue; }
+            positions.push_back(pos);
+        }
+    }
+
+    if (positions.empty()) {
+        std::fprintf(stderr, "Usage: %s [-s MB,MB,...] file...\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%10s %12s %12s %14s %10s\n", "table", "pages", "entries", "nodes", "knodes/s");
+
+    for (size_t mb : sizes) {
+        for (Pages requested : {Pages::Small, Pages::Transparent, Pages::Huge}) {
+            Solver solver(nullptr, 1, mb << 20, requested);
+            uint64_t nodes = 0;
+            double elapsed = 0;
+
+            for (Position const &pos : positions) {
+                solver.reset();
+
+                auto start = std::chrono::steady_clock::now();
+                solver.solve(pos);
+                elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                nodes += solver.getNodeCount();
+            }
+
+            TransposeTable const &table = solver.getTransTable();
+
+            // Huge pages can fall back to transparent ones, in which case that row was already measured.
+            if (requested == Pages::Huge && table.getPages() != Pages::Huge) {
+                std::printf("%8zuMB %12s %12s %14s %10s\n", mb, pagesName(requested), "-", "unavailable", "-");
+                continue;
+            }
+
+            std::printf("%8zuMB %12s %12llu %14llu %10.0f\n", mb, pagesName(table.getPages()),
+                (unsigned long long) table.getSize(), (unsigned long long) nodes, nodes/elapsed/1000);
+        }
+    }
+
+    return 0;
+};
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../include/transpositiontable.h"
+
+// Microbenchmark comparing the probe throughput of the packed TransposeTable against the previous
+//  layout, which kept the truncated keys and the values in two separate arrays.
+// Usage: ttbench [probes]
+
+namespace IBN5100 {
+    // The layout used by TranspositionTable before entries were packed into a single word.
+    template<unsigned int keySize, unsigned int valueSize, unsigned int logSize>
+    class SplitTranspositionTable {
+        private:
+            static constexpr uint64_t size = nextPrime(1ULL << logSize);
+
+            uint32_t* keys;
+            uint8_t* values;
+
+            static constexpr size_t index(uint64_t key) { return key%size; };
+
+        public:
+            inline SplitTranspositionTable() {
+                keys = new uint32_t[size];
+                values = new uint8_t[size];
+                std::memset(keys, 0, size*sizeof(uint32_t));
+                std::memset(values, 0, size*sizeof(uint8_t));
+            };
+
+            inline ~SplitTranspositionTable() {
+                delete[] keys;
+                delete[] values;
+            };
+
+            inline void add(uint64_t key, uint8_t value) {
+                size_t pos = index(key);
+                keys[pos] = key;
+                values[pos] = value;
+            };
+
+            inline uint8_t operator [](uint64_t key) const {
+                size_t pos = index(key);
+                return keys[pos] == (uint32_t) key ? values[pos] : 0;
+            };
+    };
+
+    typedef SplitTranspositionTable<49, log2(Position::maxScore - Position::minScore + 1) + 2, 23> SplitTransposeTable;
+}
+
+using namespace IBN5100;
+
+// Fill the table with half of the keys, then probe all of them so that roughly half the probes hit.
+template<typename Table>
+static double run(Table &table, std::vector<uint64_t> const &keys, uint64_t &checksum) {
+    for (size_t i = 0; i < keys.size(); i += 2) { table.add(keys[i], 1 + i%111); }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t key : keys) { checksum += table[key]; }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return keys.size()/elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    size_t probes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1ULL << 24;
+
+    std::mt19937_64 rng(5100);
+    std::vector<uint64_t> keys(probes);
+    for (uint64_t &key : keys) { key = rng() & ((1ULL << 49) - 1); }
+
+    uint64_t checksum = 0;
+
+    SplitTransposeTable* split = new SplitTransposeTable;
+    double splitRate = run(*split, keys, checksum);
+    delete split;
+
+    TransposeTable* packed = new TransposeTable;
+    double packedRate = run(*packed, keys, checksum);
+    delete packed;
+
+    std::printf("probes:        %zu\n", probes);
+    std::printf("split layout:  %.2f Mprobes/s\n", splitRate/1e6);
+    std::printf("packed layout: %.2f Mprobes/s (%.2fx)\n", packedRate/1e6, packedRate/splitRate);
+    std::printf("checksum:      %llu\n", (unsigned long long) checksum);
+
+    return 0;
+};
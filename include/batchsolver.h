@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "solver.h"
+
+namespace IBN5100 {
+    // The outcome of solving one line of a batch.
+    struct BatchResult {
+        uint64_t index; // position of the line in the input, starting at 0
+        std::string moves; // the move sequence of the line
+        bool valid; // false if the move sequence is not a legal, unfinished game
+        int score;
+        bool hasExpected; // whether the line gave an expected score
+        int expected;
+        uint64_t nodes; // nodes explored to solve the position
+        double seconds; // time spent solving the position
+    };
+
+    /**
+     * @brief Solve a stream of positions with a pool of threads, each owning its own Solver and transposition table.
+     * Results are reported in input order no matter which thread solved them.
+     * 
+     */
+    class BatchSolver {
+        private:
+            struct Job {
+                uint64_t index;
+                std::string moves;
+                bool hasExpected;
+                int expected;
+            };
+
+            std::vector<std::unique_ptr<Solver>> solvers;
+            bool weak;
+            size_t window; // maximum number of lines read ahead of the last reported result
+
+            std::mutex mutex;
+            std::condition_variable jobAvailable; // signalled when a job is queued or the input is exhausted
+            std::condition_variable resultReported; // signalled when the next result in input order has been reported
+            std::deque<Job> jobs;
+            bool inputDone;
+            std::map<uint64_t, BatchResult> finished; // results waiting for the results before them
+            uint64_t nextReport; // index of the next result to report
+
+            void work(Solver* solver, std::function<void(BatchResult const&)> const &onResult);
+
+        public:
+            /**
+             * @brief Construct a new BatchSolver.
+             * 
+             * @param numThreads (uint) The number of worker threads. 0 uses one thread per hardware core.
+             * @param tableBytes (size_t) The memory budget of each worker's transposition table.
+             * @param weak (bool) Determines if the positions will be weakly or strongly solved.
+             * @param openingBook (OpeningBook*) Optional opening book shared by every worker.
+             */
+            BatchSolver(unsigned int numThreads = 0, size_t tableBytes = TransposeTable::defaultBytes,
+                bool weak = 0, OpeningBook const* openingBook = nullptr);
+
+            BatchSolver(BatchSolver const&) = delete;
+            BatchSolver &operator =(BatchSolver const&) = delete;
+
+            /**
+             * @brief Solve every line of a stream until it is exhausted.
+             * Each line holds a move sequence optionally followed by the expected score of the position. Blank lines are skipped.
+             * 
+             * @param in (istream) The stream of positions.
+             * @param onResult (function) Called with each result in input order. Calls are never concurrent.
+             */
+            void run(std::istream &in, std::function<void(BatchResult const&)> const &onResult);
+
+            inline unsigned int getNumThreads() const { return solvers.size(); };
+    };
+}
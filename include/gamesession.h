@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "solver.h"
+
+namespace IBN5100 {
+    /**
+     * @brief A game being played or annotated move by move, answering solve and analyze for its current position.
+     * Every position of a game follows the previous ones, so the session keeps the transposition table of its Solver from one
+     *  move to the next instead of resetting it: most of the tree below the new position was already searched, and later moves
+     *  cost a fraction of a cold solve. The entries of earlier positions, which can no longer be reached, are aged out and
+     *  replaced first rather than cleared.
+     *
+     * @tparam width (int) Number of columns of the board.
+     * @tparam height (int) Number of rows of the board.
+     */
+    template<int width, int height>
+    class BasicGameSession {
+        public:
+            typedef BasicSolver<width, height> Solver;
+            typedef BasicPosition<width, height> Position;
+
+        private:
+            Solver &solver;
+            std::vector<Position> history; // every position of the game so far, the current one last
+            std::string moves; // the columns played, numbered from 1
+            bool won; // whether the last move played won the game
+
+            // The score of a finished game for the player to move.
+            inline int finalScore() const { return won ? -(Position::cells + 2 - history.back().getMoves())/2 : 0; };
+
+        public:
+            /**
+             * @brief Start a new game session.
+             *
+             * @param solver (Solver) The solver answering for the session. Its table is kept, so it should not be used for
+             *  other positions while the session is in progress.
+             * @param seq (string) The moves already played, as digits. Playing stops at the first invalid move.
+             */
+            inline BasicGameSession(Solver &solver, std::string const &seq = "") : solver{solver}, history(1), won{0} {
+                play(seq);
+                solver.advance(history.back());
+            };
+
+            /**
+             * @brief Play a move in the current position.
+             *
+             * @param col (int) The column to play, from 0.
+             * @return (bool) Whether the move was played. It is not if the column is full or the game is over.
+             */
+            inline bool play(int col) {
+                Position pos = history.back();
+                if (isOver() || col < 0 || col >= width || !pos.canPlay(col)) { return 0; }
+
+                won = pos.isWin(col);
+                pos.playCol(col);
+
+                history.push_back(pos);
+                moves += '1' + col;
+                solver.advance(pos);
+                return 1;
+            };
+
+            /**
+             * @brief Play a sequence of moves.
+             *
+             * @param seq (string) The moves to play, as digits.
+             * @return (size_t) The number of moves played. Playing stops at the first invalid move.
+             */
+            inline size_t play(std::string const &seq) {
+                for (size_t i = 0; i < seq.length(); ++i) {
+                    if (!play(seq[i] - '1')) { return i; }
+                }
+
+                return seq.length();
+            };
+
+            /**
+             * @brief Take back the last move.
+             *
+             * @return (bool) Whether a move was taken back. It is not if no move was played.
+             */
+            inline bool undo() {
+                if (moves.empty()) { return 0; }
+
+                history.pop_back();
+                moves.pop_back();
+                won = 0; // no move is played once the game is won
+                solver.advance(history.back());
+                return 1;
+            };
+
+            // Go back to the empty board. The table is kept, as every position of the new game follows the empty board.
+            inline void restart() {
+                history.resize(1);
+                moves.clear();
+                won = 0;
+                solver.advance(history.back());
+            };
+
+            /**
+             * @brief Solve the current position.
+             *
+             * @param weak (bool) Determines if the position will be weakly or strongly solved.
+             * @return (int) The score of the position, see Solver::solve. Once the game is over, this is its final score.
+             */
+            inline int solve(bool weak = 0) {
+                if (isOver()) { return weak ? (finalScore() > 0) - (finalScore() < 0) : finalScore(); }
+                return solver.solve(history.back(), weak);
+            };
+
+            /**
+             * @brief Get the score of every move of the current position, see Solver::analyze.
+             *
+             * @param weak (bool) Determines if the moves will be weakly or strongly solved.
+             * @return (array) The score of each column, Solver::invalidMove for full columns and for every column once the game is over.
+             */
+            inline std::array<int, width> analyze(bool weak = 0) {
+                if (isOver()) {
+                    std::array<int, width> scores;
+                    scores.fill(Solver::invalidMove);
+                    return scores;
+                }
+
+                return solver.analyze(history.back(), weak);
+            };
+
+            // Get the best line of play from the current position, see Solver::principalVariation. Empty once the game is over.
+            inline std::string principalVariation() const { return isOver() ? "" : solver.principalVariation(history.back()); };
+
+            // Whether the game is over, either won by the last move or drawn on a full board.
+            inline bool isOver() const { return won || history.back().getMoves() == Position::cells; };
+
+            inline bool isWon() const { return won; };
+
+            inline Position const &getPosition() const { return history.back(); };
+
+            // Get the moves played so far as digits, in the format of Position::init.
+            inline std::string const &getMoves() const { return moves; };
+    };
+
+    typedef BasicGameSession<7, 6> GameSession;
+}
@@ -7,17 +7,19 @@ namespace IBN5100 {
      * @brief Store data about the current priority of the moves. Element at the end = greatest score.
      * This is implemented as a minimum priority queue and is used to explore the moves in an optimized order.
      * 
+     * @tparam width (int) Number of columns of the board, which is the most moves a position can have.
      */
+    template<int width>
     class MoveSorter {
         private:
             int size;
-            struct { uint64_t move; int score; } moves[7];
+            struct { uint64_t move; int score; } moves[width];
 
         public:
             inline MoveSorter() : size{0} {};
 
             /**
-             * @brief Add a move with its score. Do not try to add more than 7 moves.
+             * @brief Add a move with its score. Do not try to add more than width moves.
              * 
              * @param move (uint64) The move to add.
              * @param score (int) The score of the move.
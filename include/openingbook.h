@@ -1,59 +1,118 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "position.h"
-#include "transpositiontable.h"
 
 // todo add a way to remove positions that have been stored in the opening book
 
-// The default buffer size for opening book. This is equivalent to 512KB + 256KB + 2 bytes.
-// This way we can store up to uint16_max positions in our buffer at any time alongside the number of positions.
-#define BUFFER_SIZE 524288 + 262144 + 2
-
 namespace IBN5100 {
     /**
-     * @brief 
+     * @brief A read-only collection of solved positions, memory-mapped from disk and probed directly during the search.
+     * Positions saved to the book are kept in memory and merged into the file when the book is written or destroyed.
+     * 
+     * File format (native byte order):
+     *  - Header: the magic "IBN5100B", the format version, the largest number of moves of any stored position,
+     *     and the number of entries.
+     *  - Entries: one 64-bit word per position, sorted in increasing order. The position's symmetric key is stored in the
+     *     high bits and its score minus minScore in the low 8 bits, so sorting the words sorts the keys.
      * 
      */
     class OpeningBook {
         private:
+            struct Header {
+                char magic[8];
+                uint32_t version;
+                uint32_t maxMoves;
+                uint64_t numEntries;
+            };
+
+            static constexpr char magic[8] = {'I', 'B', 'N', '5', '1', '0', '0', 'B'};
+            static constexpr uint32_t version = 1;
+
             std::string filename;
-            char buffer[BUFFER_SIZE] = {'\0'};
-            size_t bufferSize = 2; // Start at 2 to reserve 2 bytes for the number of positions.
-            uint16_t numPos = 0;
-
-            // Serialize an arbitrary primitive of type T.
-            // Do NOT use this function on non-trivial datatypes.
-            // It is not recommended to use on pointers as only the memory address will be serialized.
-            template <typename T>
-            static constexpr void serializePrimitive(char* buffer, size_t &bufferSize, T n) {
-                std::memcpy(&buffer[bufferSize], &n, sizeof(T));
-                bufferSize += sizeof(T);
+
+            void* map = nullptr; // read-only mapping of the whole file
+            size_t mapLength = 0;
+            uint64_t const* entries = nullptr; // points into map, just past the header
+            uint64_t numEntries = 0;
+            int maxMoves = -1; // no position with more moves than this is stored in the book
+
+            std::vector<uint64_t> pending; // saved entries that have not been written to the file yet
+            int pendingMaxMoves = -1;
+
+            bool invalid = 0; // the file exists but could not be read as a book, so it must not be overwritten
+
+            static constexpr uint64_t encode(uint64_t key, int score) { return key << 8 | (score - Position::minScore); };
+
+            // Map the file if it exists and holds a valid book. A file that cannot be read as one marks the book invalid.
+            void open();
+            void close();
+
+            // Take over the mapping and the pending entries of another book, leaving it empty.
+            void take(OpeningBook &other);
+
+        public:
+            inline OpeningBook(std::string const &filename) : filename{filename} { open(); };
+
+            inline OpeningBook(OpeningBook &&other) { take(other); };
+
+            inline OpeningBook &operator =(OpeningBook &&other) {
+                if (this != &other) {
+                    write();
+                    close();
+                    take(other);
+                }
+
+                return *this;
             };
 
-            // Deserialize an arbitrary primitive of type T.
-            // Do NOT use this function on non-trivial datatypes.
-            // It is not recommended to use on pointers as only the memory address will be serialized.
-            template <typename T>
-            static constexpr T deserializePrimitive(std::vector<char> const &buffer, size_t &currIndex) {
-                T n;
-                std::memcpy(&n, &buffer[currIndex], sizeof(T));
-                currIndex += sizeof(T);
-                return n;
+            // Copies would each write the same pending entries to the same file.
+            OpeningBook(OpeningBook const&) = delete;
+            OpeningBook &operator =(OpeningBook const&) = delete;
+
+            inline ~OpeningBook() {
+                write();
+                close();
             };
 
-            static void writeToFile(std::string const &filename, char* buffer, size_t bufferSize, uint16_t numPositions);
-        
-        public:
-            inline OpeningBook(std::string const &filename) : filename{filename} {};
+            // Save the position's score to the opening book. It is stored under its symmetric key, which the position and
+            //  its mirror image share, so both are found by get.
+            inline void save(Position const &pos, int score) { save(pos.symmetricKey(), pos.getMoves(), score); };
+
+            /**
+             * @brief Save a position's score to the opening book via its key.
+             * 
+             * @param key (uint64) The position's symmetric key.
+             * @param moves (int) The number of moves played in the position.
+             * @param score (int) The position's exact score.
+             */
+            void save(uint64_t key, int moves, int score);
+
+            /**
+             * @brief Merge the saved positions into the book's file. Positions saved more than once keep their latest score.
+             * 
+             * @return (bool) Whether every saved position is in the file. Nothing is written if the book is invalid, so that
+             *  a file in another format is never replaced.
+             */
+            bool write();
+
+            /**
+             * @brief Look up the score of a position.
+             * 
+             * @param key (uint64) The position's symmetric key.
+             * @param score (int) Set to the position's exact score if it is in the book.
+             * @return (bool) Whether the position is in the book.
+             */
+            bool get(uint64_t key, int &score) const;
 
-            inline ~OpeningBook() { writeToFile(filename, buffer, bufferSize, numPos); };
+            // Get the largest number of moves of a stored position. Positions with more moves do not need to be looked up.
+            inline int getMaxMoves() const { return maxMoves; };
 
-            // Save the position to the opening book via its key.
-            void save(uint64_t key, int score);
+            inline uint64_t getNumEntries() const { return numEntries; };
 
-            // Load the opening book into a TranspositionTable of default configuration.
-            void load(TransposeTable* t);
+            // Whether the file is missing or holds a book of this format. An invalid book is empty and is never written.
+            inline bool isValid() const { return !invalid; };
     };
 }
@@ -12,11 +12,11 @@ namespace IBN5100 {
     };
 
     /**
-     * @brief Represent the current state of a 7x6 Connect 4 position with a bitboard.
+     * @brief Represent the current state of a Connect 4 position with a bitboard.
      * Functions are relative to the current player to play.
      * 
-     * Each column is encoded with 7 bits (instead of just 6).
-     * Bit order for encoding the 7x6 board:
+     * Each column is encoded with height + 1 bits (instead of just height), so the whole board needs width*(height + 1) bits.
+     * Bit order for encoding the standard 7x6 board:
      * .  .  .  .  .  .  .
      * 5 12 19 26 33 40 47
      * 4 11 18 25 32 39 46
@@ -33,29 +33,51 @@ namespace IBN5100 {
      *  on top of the last occupied cell of each column.
      * Key can be computed as follows: key = pos + mask + bottom.
      * Since bottom is constant, key = pos + mask would also be a unique representation.
+     * 
+     * Each column of the key fits in its own height + 1 bits, so the key of the mirrored position is the key with its columns reversed.
+     * A position and its mirror have the same score, so the smaller of the two keys is used as a symmetric key shared by both.
+     * 
+     * Every mask and shift is derived from the dimensions at compile time, so each board size gets code as specialized as a
+     *  hand written version. Use the Position typedef for the standard board.
+     * 
+     * @tparam width (int) Number of columns of the board.
+     * @tparam height (int) Number of rows of the board.
      */
-    class Position {
+    template<int width, int height>
+    class BasicPosition {
+        static_assert(width >= 4 || height >= 4, "no alignment fits on the board");
+        static_assert(width <= 9, "columns are written as a single digit");
+        static_assert(width*(height + 1) <= 64, "the board does not fit in a 64-bit bitboard");
+
         private:
             uint64_t pos = 0; // bitmap storing a 1 to represent every cell the current player has a piece in
             uint64_t mask = 0; // bitmask storing a 1 to represent every cell containing a piece
             int moves = 0; // moves played since the start of the game
 
-            static constexpr uint64_t bottomMask = bottom(7, 6);
-            static constexpr uint64_t boardMask = bottomMask * ((1ULL << 6) - 1);
+            // Cells completing an alignment for the current player and for the opponent. They are kept up to date by play, which
+            //  only has to compute the cells of the player who moves, as the other player's cells stay the same. Cells
+            //  filled since they were computed are masked out when read.
+            uint64_t wins = 0;
+            uint64_t oppWins = 0;
+
+            static constexpr uint64_t bottomMask = bottom(width, height);
+            static constexpr uint64_t boardMask = bottomMask * ((1ULL << height) - 1);
 
-            inline uint64_t winPos() const { return computeWinPos(pos, mask); };
-            inline uint64_t oppWinPos() const { return computeWinPos(pos ^ mask, mask); };
+            inline uint64_t winPos() const { return wins & ~mask; };
+            inline uint64_t oppWinPos() const { return oppWins & ~mask; };
             inline uint64_t possibleMoves() const { return (mask + bottomMask) & boardMask; };
 
             /**
              * @brief Determine all cells resulting in a win for the current player.
+             * This also works on vectors of bitboards (GCC vector extensions), computing the winning cells of every lane at once.
              * 
              * @param pos (uint64) A bitmap with all the cells occupied by the current player.
              * @param mask (uint64) A bitmask with all the occupied cells.
              * @return A bitmap with a 1 representing all the winning cells for the current player.
              */
-            static constexpr uint64_t computeWinPos(uint64_t pos, uint64_t mask) {
-                uint64_t r = 0;
+            template<typename T>
+            static constexpr T computeWinPos(T pos, uint64_t mask) {
+                T r{};
 
                 // * ===========
                 // * Vertical
@@ -71,15 +93,17 @@ namespace IBN5100 {
                 // * Horizontal
                 // * =============
 
+                constexpr int h = height + 1; // distance between horizontally adjacent cells
+
                 // Left side horizontal
-                uint64_t p = (pos << 7) & (pos << 14);
-                r |= p & (pos << 21);
-                r |= p & (pos >> 7);
+                T p = (pos << h) & (pos << 2*h);
+                r |= p & (pos << 3*h);
+                r |= p & (pos >> h);
 
                 // Right side horizontal
-                p = (pos >> 7) & (pos >> 14);
-                r |= p & (pos >> 21);
-                r |= p & (pos << 7);
+                p = (pos >> h) & (pos >> 2*h);
+                r |= p & (pos >> 3*h);
+                r |= p & (pos << h);
 
 
                 // * ============
@@ -87,37 +111,88 @@ namespace IBN5100 {
                 // * ============
 
                 // Diagonal 1
-                p = (pos << 6) & (pos << 12);
-                r |= p & (pos << 18);
-                r |= p & (pos >> 6);
-                p = (pos >> 6) & (pos >> 12);
-                r |= p & (pos >> 18);
-                r |= p & (pos << 6);
+                constexpr int d1 = height;
+                p = (pos << d1) & (pos << 2*d1);
+                r |= p & (pos << 3*d1);
+                r |= p & (pos >> d1);
+                p = (pos >> d1) & (pos >> 2*d1);
+                r |= p & (pos >> 3*d1);
+                r |= p & (pos << d1);
 
                 // Diagonal 2
-                p = (pos << 8) & (pos << 16);
-                r |= p & (pos << 24);
-                r |= p & (pos >> 8);
-                p = (pos >> 8) & (pos >> 16);
-                r |= p & (pos >> 24);
-                r |= p & (pos << 8);
+                constexpr int d2 = height + 2;
+                p = (pos << d2) & (pos << 2*d2);
+                r |= p & (pos << 3*d2);
+                r |= p & (pos >> d2);
+                p = (pos >> d2) & (pos >> 2*d2);
+                r |= p & (pos >> 3*d2);
+                r |= p & (pos << d2);
 
                 // xor the mask with the boardMask to ensure the cell detected as winning has not already been played
                 return r & (boardMask ^ mask);
             };
 
-            static constexpr uint64_t topMaskCol(int c) { return 1ULL << (5 + c*7); };
-            static constexpr uint64_t bottomMaskCol(int c) { return 1ULL << c*7; };
+            // Reverse the order of the columns of a bitboard. The loop is unrolled by the compiler into one shift per column.
+            static constexpr uint64_t mirror(uint64_t b) {
+                constexpr uint64_t col = (1ULL << (height + 1)) - 1;
+
+                uint64_t m = 0;
+                for (int c = 0; c < width; ++c) { m |= (b >> c*(height + 1) & col) << (width - 1 - c)*(height + 1); }
+                return m;
+            };
+
+            // Determine if a bitmap holds 4 aligned cells.
+            static constexpr bool hasAlignment(uint64_t b) {
+                uint64_t m;
+
+            #ifndef NO_VERTICALS
+
+                m = b & (b >> 1);
+                if (m & (m >> 2)) { return 1; }
+
+            #endif
+
+                // horizontal, then both diagonals
+                for (int shift : {height + 1, height, height + 2}) {
+                    m = b & (b >> shift);
+                    if (m & (m >> 2*shift)) { return 1; }
+                }
+
+                return 0;
+            };
+
+            // Generate a bitmask of the cells of every other row, starting with the given row.
+            static constexpr uint64_t alternateRows(int first) {
+                uint64_t col = 0;
+                for (int r = first; r < height; r += 2) { col |= 1ULL << r; }
+                return col*bottomMask;
+            };
+
+            // The rows where the next move of a column with an even number of empty cells is played.
+            static constexpr uint64_t claimRows = alternateRows(height & 1);
 
-            // This play method is used for the initialization of the board and is made private to avoid 
-            //  issues with overloads between int and uint64_t.
-            inline void play(int c) { play((mask + bottomMaskCol(c)) & columnMask(c)); };
+            static constexpr uint64_t topMaskCol(int c) { return 1ULL << (height - 1 + c*(height + 1)); };
+            static constexpr uint64_t bottomMaskCol(int c) { return 1ULL << c*(height + 1); };
+
+            // Computes moveScores for a position given as its pos and mask bitboards.
+            // Set to the fastest implementation supported by the CPU when the program starts.
+            static void (*const scoreMoves)(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]);
+
+            static void scoreMovesScalar(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]);
+            static void scoreMovesAVX2(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]);
+            static void scoreMovesAVX512(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]);
+            static void (*selectScoreMoves())(uint64_t, uint64_t, uint64_t, int*, uint64_t*);
 
         public:
-            static constexpr int minScore = -18;
-            static constexpr int maxScore = 18;
+            static constexpr int columns = width;
+            static constexpr int rows = height;
+            static constexpr int cells = width*height;
+            static constexpr int keySize = width*(height + 1); // number of bits of a key
+
+            static constexpr int minScore = -cells/2 + 3;
+            static constexpr int maxScore = (cells + 1)/2 - 3;
 
-            constexpr Position() : pos{0}, mask{0}, moves{0} {};
+            constexpr BasicPosition() : pos{0}, mask{0}, moves{0}, wins{0}, oppWins{0} {};
 
             /**
              * @brief Plays a sequence of moves to initialize a board state/
@@ -131,8 +206,8 @@ namespace IBN5100 {
 
                 for (size_t i = 0; i < seq.length(); ++i) {
                     c = seq[i] - '1';
-                    if (c < 0 || c >= 7 || !canPlay(c) || isWin(c)) { return i; }
-                    play(c);
+                    if (c < 0 || c >= width || !canPlay(c) || isWin(c)) { return i; }
+                    playCol(c);
                 }
 
                 return seq.length();
@@ -140,7 +215,21 @@ namespace IBN5100 {
 
             inline bool canPlay(int c) const { return !(mask & topMaskCol(c)); };
 
-            inline void play(uint64_t move) {
+            // Play a piece in column c. This is named differently from play to avoid issues with overloads between int and uint64_t.
+            inline void playCol(int c) { play((mask + bottomMaskCol(c)) & columnMask(c)); };
+
+            inline void play(uint64_t move) { play(move, computeWinPos(pos | move, mask | move)); };
+
+            /**
+             * @brief Play a move whose winning cells were already computed, such as by moveScores.
+             * 
+             * @param move (uint64) The move to play.
+             * @param moveWins (uint64) The cells completing an alignment for the current player once the move is played.
+             */
+            inline void play(uint64_t move, uint64_t moveWins) {
+                wins = oppWins;
+                oppWins = moveWins;
+
                 pos ^= mask;
                 mask |= move;
                 ++moves;
@@ -152,6 +241,8 @@ namespace IBN5100 {
                 pos = 0;
                 mask = 0;
                 moves = 0;
+                wins = 0;
+                oppWins = 0;
             };
 
             inline bool canWinNext() const { return winPos() & possibleMoves(); };
@@ -172,17 +263,62 @@ namespace IBN5100 {
                 return possibleMask & ~(oppWin >> 1);
             };
 
-            inline int moveScore(uint64_t move) const {
-                uint64_t p = computeWinPos(pos | move, mask);
-                
-                int n = 0;
-                for (; p; ++n) { p &= p - 1; }
-                return n;
-            };
+            // Get the number of empty cells that would complete an alignment for the current player.
+            inline int threatCount() const { return __builtin_popcountll(winPos()); };
+
+            // Get the number of empty cells that would complete an alignment for the opponent.
+            inline int oppThreatCount() const { return __builtin_popcountll(oppWinPos()); };
+
+            /**
+             * @brief Count the winning cells the current player would have after playing a move, for a move in every column
+             *  at once, using SIMD instructions when the CPU supports them.
+             * 
+             * @param moves (uint64) A bitmap with at most one move per column.
+             * @param scores (int[width]) Set to the number of winning cells after the move of each column. Columns without a
+             *              move are left with a meaningless value.
+             * @param moveWins (uint64[width]) Set to the cells completing an alignment for the current player after the move of
+             *              each column, to be given to play along with the move.
+             */
+            inline void moveScores(uint64_t moves, int scores[width], uint64_t moveWins[width]) const { scoreMoves(pos, mask, moves, scores, moveWins); };
             
+            /**
+             * @brief Bound the score of the current player with the claimeven rule.
+             * When every column has an even number of empty cells, the opponent can answer each move by playing on top of it,
+             *  which gives them every other empty cell of each column, starting from the second one, and the current player
+             *  the rest. If the cells the current player ends up with hold no alignment, they cannot win. If the opponent's
+             *  cells do, the opponent wins by the time the board is full at the latest.
+             * 
+             * @return (int) The greatest score the current player can get: -1 if the opponent wins by claiming the even cells,
+             *  0 if they can at least draw that way, and maxScore if the rule does not apply.
+             */
+            inline int claimevenBound() const {
+                // The next empty cell of every column must be in the current player's rows.
+                if (possibleMoves() & ~claimRows) { return maxScore; }
+
+                uint64_t empty = boardMask & ~mask;
+                if (hasAlignment(pos | (empty & claimRows))) { return maxScore; }
+
+                return hasAlignment((pos ^ mask) | (empty & ~claimRows)) ? -1 : 0;
+            };
+
             inline uint64_t key() const { return pos + mask; };
+
+            // Get a key shared by the position and its mirror image.
+            inline uint64_t symmetricKey() const { return symmetricKey(key()); };
             inline int getMoves() const { return moves; };
 
-            static constexpr uint64_t columnMask(int c) { return ((1ULL << 6) - 1) << 7*c; };
+            static constexpr uint64_t columnMask(int c) { return ((1ULL << height) - 1) << (height + 1)*c; };
+
+            // Get the column of a move.
+            static inline int moveColumn(uint64_t move) { return __builtin_ctzll(move)/(height + 1); };
+
+            // Get the symmetric key of a position from its key. This is the smaller of the key and the key of the mirrored position.
+            static constexpr uint64_t symmetricKey(uint64_t key) {
+                uint64_t m = mirror(key);
+                return m < key ? m : key;
+            };
     };
+
+    // The standard 7x6 board.
+    typedef BasicPosition<7, 6> Position;
 }
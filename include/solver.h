@@ -1,38 +1,294 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "openingbook.h"
 #include "movesorter.h"
+#include "stats.h"
+#include "transpositiontable.h"
 
 // todo optimize existing components as currently it is a little slow
-// todo add an analyze function
-// todo add an opening book
 // todo remove the asserts for the final version
 
 namespace IBN5100 {
-    class Solver {
+    // The result of a time-bounded search.
+    struct Evaluation {
+        int move; // the best column found, or -1 if the position has no playable column
+        int score; // the exact score if proven, otherwise a heuristic estimate that is positive when the current player is ahead
+        bool proven; // whether score is the exact score of the position
+        int depth; // the depth of the deepest completed search
+    };
+
+    // The progress of an exact search, reported each time its window narrows and returned once it ends.
+    struct SolveProgress {
+        int min, max; // the bounds the score is known to lie within, equal once the position is solved
+        uint64_t nodes; // the nodes searched so far
+        bool cancelled; // whether the search was cancelled before the score was found
+    };
+
+    typedef std::function<void(SolveProgress const&)> ProgressCallback;
+
+    // Statistics about the move ordering of a search.
+    struct OrderingStats {
+        uint64_t nodes = 0; // nodes whose moves were searched
+        uint64_t cutoffs = 0; // nodes where a move caused a beta cutoff
+        uint64_t firstMoveCutoffs = 0; // cutoffs caused by the first move searched
+        uint64_t cutoffMoves = 0; // moves searched in the nodes that had a cutoff, including the one causing it
+    };
+
+    // Detailed statistics of a search. These are only counted when the library is built with IBN5100_STATS, see stats.h.
+    struct SearchStats {
+        static constexpr int maxCells = 64; // most cells of a board that fits in a bitboard
+        static constexpr int maxWidth = 9; // most columns of a board
+
+        uint64_t nodesByPly[maxCells + 1] = {}; // nodes searched after each number of moves played
+        uint64_t cutoffsByMove[maxWidth] = {}; // beta cutoffs by index of the move causing them in the search order
+        uint64_t bookHits = 0; // positions found in the opening book
+        uint64_t ttProbes = 0, ttHits = 0; // probes of the transposition table and probes that found their position
+        uint64_t ttOverwrites = 0; // stores that replaced the entry of another position
+        uint64_t exactHits = 0, lowerHits = 0, upperHits = 0; // table hits by kind of bound
+        uint64_t minExits = 0, maxExits = 0; // nodes whose window was closed by the least or the greatest score still possible
+        uint64_t lowerExits = 0, upperExits = 0; // nodes whose window was closed by a lower or an upper bound from the table
+        uint64_t threatExits = 0; // nodes whose window was closed by the static threat analysis
+        uint64_t etcExits = 0; // nodes cut off by the table entry of one of their children before any child was searched
+
+        inline SearchStats &operator +=(SearchStats const &other) {
+            for (int i = 0; i <= maxCells; ++i) { nodesByPly[i] += other.nodesByPly[i]; }
+            for (int i = 0; i < maxWidth; ++i) { cutoffsByMove[i] += other.cutoffsByMove[i]; }
+
+            bookHits += other.bookHits;
+            ttProbes += other.ttProbes;
+            ttHits += other.ttHits;
+            ttOverwrites += other.ttOverwrites;
+            exactHits += other.exactHits;
+            lowerHits += other.lowerHits;
+            upperHits += other.upperHits;
+            minExits += other.minExits;
+            maxExits += other.maxExits;
+            lowerExits += other.lowerExits;
+            upperExits += other.upperExits;
+            threatExits += other.threatExits;
+            etcExits += other.etcExits;
+            return *this;
+        };
+    };
+
+    /**
+     * @brief Solve Connect 4 positions of a board size fixed at compile time. Use the Solver typedef for the standard board.
+     * 
+     * @tparam width (int) Number of columns of the board.
+     * @tparam height (int) Number of rows of the board.
+     */
+    template<int width, int height>
+    class BasicSolver {
+        public:
+            typedef BasicPosition<width, height> Position;
+            typedef BoardTransposeTable<width, height> TransposeTable;
+
         private:
-            uint64_t nodeCount; // track the number of explored nodes
-            int colOrder[7] = {3, 4, 2, 5, 1, 6, 0}; // current priority for the columns
+            static constexpr unsigned int boundSize = boundBits<width, height>;
+
+            // Opening books hold positions of the standard board, so they are only probed when solving it.
+            static constexpr bool standardBoard = width == 7 && height == 6;
+
+            // Identifies the encoding of the transposition table values in snapshots. The low bits are a version to be
+            //  increased whenever the meaning of the keys or values changes.
+            static constexpr uint64_t tableFormat = (uint64_t) width << 40 | (uint64_t) height << 32 | boundSize << 16 | 1;
+
+            /**
+             * @brief The search state owned by a single thread.
+             * Every worker searches the same positions as the others, but in a different column order.
+             * All workers share the Solver's transposition table, so a result found by one of them is
+             *  immediately available to the rest (Lazy SMP).
+             * 
+             */
+            struct Worker {
+                uint64_t nodeCount = 0; // track the number of nodes explored by this worker
+                int colOrder[width]; // current priority for the columns
+                OrderingStats stats; // how well the moves were ordered in the nodes explored by this worker
+                int history[2][Position::keySize]; // how often playing a cell caused a cutoff, weighted by the depth left, for each player
+                uint64_t killers[Position::cells + 1][2]; // the last two moves that caused a cutoff after each number of moves played
+
+            #ifdef IBN5100_STATS
+
+                SearchStats counters; // detailed statistics of the nodes explored by this worker
+
+            #endif
+            };
+
+            // Weights of the move ordering. A move is scored by the threats it creates first, then by whether it is a
+            //  killer move, then by its history.
+            static constexpr int threatWeight = 1 << 16;
+            static constexpr int killerWeight = 1 << 15;
+            static constexpr int maxHistory = (1 << 14) - 1;
+
+            // Clear the history and killer moves of every worker.
+            void resetOrdering();
+
+            // Clear the node counts and statistics of the last search.
+            inline void resetCounters() {
+                for (Worker &w : workers) {
+                    w.nodeCount = 0;
+                    w.stats = OrderingStats();
+
+                #ifdef IBN5100_STATS
+
+                    w.counters = SearchStats();
+
+                #endif
+                }
+
+                transTable.resetStats(); // does nothing without IBN5100_STATS
+            };
+
+            std::vector<Worker> workers; // workers[0] is run on the calling thread
+
+            // The helper threads run workers[1..] and live as long as the Solver, waiting for the next probe in between, so
+            //  a solve does not pay for starting threads on each of its probes.
+            std::vector<std::thread> helpers;
+            std::mutex poolMutex;
+            std::condition_variable probeReady; // signalled when a probe is posted or the Solver is destroyed
+            std::condition_variable probeDone; // signalled when the last helper finishes the current probe
+            uint64_t probeIndex = 0; // incremented for every probe posted to the helpers
+            unsigned int running = 0; // helpers still searching the current probe
+            bool shuttingDown = 0;
+
+            // The probe being searched by every worker. Only written while no helper is running.
+            Position probePos;
+            int probeAlpha, probeBeta, probeResult;
+            std::atomic<bool> stop{0}; // set once a worker has finished the current probe
+            std::atomic<bool> cancelled{0}; // set by cancel until the next search is started
             TransposeTable transTable;
+            OpeningBook const* book; // exact scores of shallow positions, probed before the transposition table
+            std::chrono::steady_clock::time_point deadline; // when a time-bounded search has to stop
+
+            // Scores of the depth-limited search are scaled so that a heuristic estimate, which always lies strictly between
+            //  -provenScale and provenScale, never outranks a proven win or loss.
+            static constexpr int provenScale = 1000;
         
+            // Clear stop before a probe, unless the search has been cancelled. A cancel racing with this leaves stop set,
+            //  as cancelled is read after the store.
+            inline void resetStop() {
+                stop.store(0);
+                if (cancelled.load()) { stop.store(1); }
+            };
+
             /**
              * @brief Recursively solve a Connect 4 position using a negamax alpha-beta pruning algorithm.
              * 
+             * @param worker (Worker) The search state of the thread running the search.
+             * @param pos (Position) The position to evaluate. It is assumed that no one has already won and that
+             *              the current player cannot win this move.
+             * @param alpha (int) The lower bound score of the position.
+             * @param beta (int) The upper bound score of the position.
+             * @return The exact score of the position. The value is meaningless if stop was set during the search.
+             */
+            int negamax(Worker &worker, Position const &pos, int alpha, int beta);
+
+            // Positions with this many empty cells or fewer are searched by endgame rather than negamax.
+            static constexpr int endgameCells = Position::cells < 10 ? Position::cells : 10;
+
+            /**
+             * @brief Solve a position close to the end of the game with a plain alpha-beta search.
+             * The tree left is so small that probing the transposition table and sorting the moves cost more than they save,
+             *  so the moves are tried in column order without either. The number of empty cells is a template parameter, so
+             *  the recursion is unrolled at compile time and the draw and score bounds are constants at every level.
+             * 
+             * @tparam empty (int) The number of empty cells of the position.
+             * @param nodes (uint64) Incremented for every position searched.
+             * @param colOrder (int*) The order to try the columns in.
+             * @param pos (Position) The position to evaluate. It is assumed that no one has already won and that
+             *              the current player cannot win this move.
+             * @param alpha (int) The lower bound score of the position.
+             * @param beta (int) The upper bound score of the position.
+             * @return The exact score of the position if it is within the window, otherwise a bound on the side of the window it is on.
+             */
+            template<int empty>
+            static int endgame(uint64_t &nodes, int const* colOrder, Position const &pos, int alpha, int beta);
+
+            // Call endgame with the template parameter matching the number of empty cells of the position.
+            template<int empty = endgameCells>
+            static int endgameSearch(uint64_t &nodes, int const* colOrder, Position const &pos, int alpha, int beta);
+
+            // Search the current probe with a worker. The first worker to finish publishes its score and stops the others.
+            void runProbe(Worker &worker);
+
+            // The loop of a helper thread, running a worker on every probe posted until the Solver is destroyed.
+            void help(Worker &worker);
+
+            /**
+             * @brief Run the same alpha-beta search on every worker and return the result of the first one to finish.
+             * 
              * @param pos (Position) The position to evaluate. It is assumed that no one has already won and that
              *              the current player cannot win this move.
              * @param alpha (int) The lower bound score of the position.
              * @param beta (int) The upper bound score of the position.
              * @return The exact score of the position.
              */
-            int negamax(Position const &pos, int alpha, int beta);
+            int search(Position const &pos, int alpha, int beta);
+
+            /**
+             * @brief Compute the score of a position by narrowing its window with null-window searches.
+             * Unlike solve, this does not reset the node count.
+             * 
+             * @param pos (Position) The position to solve. It is assumed that no one has already won.
+             * @param weak (bool) Determines if the position will be weakly or strongly solved.
+             * @param onProgress (ProgressCallback) Optional function called with the starting window and after every probe.
+             * @return (SolveProgress) The final window, whose bounds are both the score of the position unless it was cancelled.
+             */
+            SolveProgress solveScore(Position const &pos, bool weak, ProgressCallback const &onProgress = nullptr);
+
+            /**
+             * @brief Estimate the score of a position from the threats of both players.
+             * 
+             * @param pos (Position) The position to estimate.
+             * @return The estimate, strictly between -provenScale and provenScale.
+             */
+            static int heuristic(Position const &pos);
+
+            /**
+             * @brief Search a position to a fixed depth with a negamax alpha-beta pruning algorithm, estimating the score
+             *  of the positions at the search horizon. Sets stop once the deadline has passed.
+             * 
+             * @param worker (Worker) The search state of the thread running the search.
+             * @param pos (Position) The position to evaluate. It is assumed that no one has already won and that
+             *              the current player cannot win this move.
+             * @param alpha (int) The lower bound score of the position.
+             * @param beta (int) The upper bound score of the position.
+             * @param depth (int) The number of moves to search before estimating.
+             * @return The score of the position scaled by provenScale if it is proven, an estimate otherwise.
+             *  The value is meaningless if stop was set during the search.
+             */
+            int negamaxDepth(Worker &worker, Position const &pos, int alpha, int beta, int depth);
 
         public:
-            inline Solver(OpeningBook* openingBook = nullptr) {
-                reset();
+            // The score given by analyze to the columns that cannot be played.
+            static constexpr int invalidMove = -1000;
 
-                // If we are provided an opening book, load the positions into the transposition table
-                if (openingBook != nullptr) { openingBook->load(&transTable); }
-            };
+            /**
+             * @brief Construct a new Solver.
+             * 
+             * @param openingBook (OpeningBook*) Optional opening book to look shallow positions up in. It must outlive the Solver.
+             *              It is ignored on boards other than 7x6.
+             * @param numThreads (uint) The number of threads used by solve. 0 uses one thread per hardware core.
+             * @param tableBytes (size_t) The memory budget of the transposition table.
+             * @param pages (Pages) The kind of pages to back the transposition table with.
+             */
+            BasicSolver(OpeningBook const* openingBook = nullptr, unsigned int numThreads = 1,
+                size_t tableBytes = TransposeTable::defaultBytes, Pages pages = Pages::Huge);
+
+            ~BasicSolver();
+
+            BasicSolver(BasicSolver const&) = delete;
+            BasicSolver &operator =(BasicSolver const&) = delete;
 
             /**
              * @brief Solve a Connect 4 position either weakly or strongly.
@@ -46,11 +302,154 @@ namespace IBN5100 {
              */
             int solve(Position const &pos, bool weak = 0);
 
-            inline uint64_t getNodeCount() const { return nodeCount; };
+            /**
+             * @brief Solve a Connect 4 position on another thread, reporting the window of its score as it narrows.
+             * The Solver must not be used for anything else until the returned future is ready, except to cancel it.
+             * 
+             * @param pos (Position) The position to solve. It is assumed that no one has already won.
+             * @param weak (bool) Determines if the position will be weakly or strongly solved.
+             * @param onProgress (ProgressCallback) Optional function called on the solving thread with the starting window
+             *  and again after every probe, which can take from microseconds to minutes depending on the position.
+             * @return (future<SolveProgress>) The final window. Its bounds are both the score unless the search was cancelled,
+             *  in which case they are the tightest bounds proven before that.
+             */
+            std::future<SolveProgress> solveAsync(Position const &pos, bool weak = 0, ProgressCallback onProgress = nullptr);
+
+            /**
+             * @brief Stop the current search as soon as possible. Safe to call from any thread.
+             * solveAsync then returns the bounds found so far, the results of solve and analyze are meaningless and evaluate
+             *  returns its deepest completed search as if its time had run out. Nothing is stored in the transposition table
+             *  for the positions that were being searched. The next search clears the cancellation.
+             * 
+             */
+            inline void cancel() {
+                cancelled.store(1);
+                stop.store(1);
+            };
+
+            /**
+             * @brief Solve every move of a Connect 4 position either weakly or strongly.
+             * The transposition table is shared by all the moves, which makes this much cheaper than solving each child.
+             * 
+             * @param pos (Position) The position to analyze. It is assumed that no one has already won.
+             * @param weak (bool) Determines if the moves will be weakly or strongly solved.
+             * @return (array<int, width>) The score of playing in each column, from the perspective of the current player.
+             *  Full columns are given invalidMove.
+             */
+            std::array<int, width> analyze(Position const &pos, bool weak = 0);
+
+            /**
+             * @brief Find the best move of a Connect 4 position within a time limit.
+             * Searches of increasing depth are run until the time runs out or the score is proven. Positions beyond the
+             *  search depth are estimated from the threats of both players.
+             * 
+             * @param pos (Position) The position to evaluate. It is assumed that no one has already won.
+             * @param timeLimit (milliseconds) The time the search may take. The first search is always completed.
+             * @return (Evaluation) The best move and score of the deepest completed search.
+             */
+            Evaluation evaluate(Position const &pos, std::chrono::milliseconds timeLimit);
+
+            /**
+             * @brief Get the best line of play from a position by following the best moves stored in the transposition table.
+             * This is meant to be called after solving the position. The line stops early if the table lacks an entry,
+             *  for example when a position's score came from the opening book. The last endgameCells moves are not stored
+             *  in the table, so they are found by solving the end of the game again, which is cheap.
+             * 
+             * @param pos (Position) The position the line starts from.
+             * @return (string) The line as a sequence of columns numbered from 1, in the format of Position::init.
+             *  The first move is the best move of the position.
+             */
+            std::string principalVariation(Position const &pos) const;
+
+            // Get the number of nodes explored by all the threads during the last call to solve or analyze.
+            inline uint64_t getNodeCount() const {
+                uint64_t n = 0;
+                for (Worker const &w : workers) { n += w.nodeCount; }
+                return n;
+            };
+
+            // Get the move ordering statistics of all the threads during the last call to solve or analyze.
+            inline OrderingStats getOrderingStats() const {
+                OrderingStats total;
+
+                for (Worker const &w : workers) {
+                    total.nodes += w.stats.nodes;
+                    total.cutoffs += w.stats.cutoffs;
+                    total.firstMoveCutoffs += w.stats.firstMoveCutoffs;
+                    total.cutoffMoves += w.stats.cutoffMoves;
+                }
+
+                return total;
+            };
+
+            /**
+             * @brief Get the detailed statistics of all the threads during the last call to solve or analyze.
+             * Every counter is 0 unless the library is built with IBN5100_STATS.
+             * 
+             * @return (SearchStats) The statistics of the search. The transposition table counters include every probe and store
+             *  of the table, while the rest only count the nodes of the exact search.
+             */
+            inline SearchStats getSearchStats() const {
+                SearchStats total;
+
+            #ifdef IBN5100_STATS
+
+                for (Worker const &w : workers) { total += w.counters; }
+
+            #endif
+
+                total.ttProbes = transTable.getProbes();
+                total.ttHits = transTable.getHits();
+                total.ttOverwrites = transTable.getOverwrites();
+                return total;
+            };
+
+            inline unsigned int getNumThreads() const { return workers.size(); };
+
+            // Defined in solver.cpp, as GCC leaves this accessor out of the explicit instantiations when it is inline, which
+            //  breaks the link of unoptimized builds that do not inline it either.
+            TransposeTable const &getTransTable() const;
+
+            /**
+             * @brief Save the transposition table to a snapshot file, so that a later process can start with its results.
+             * Do not call this while solving.
+             * 
+             * @param filename (string) The snapshot file to write.
+             * @return (bool) Whether the snapshot was written. A file at the path that is not a snapshot is never replaced.
+             */
+            inline bool saveTable(std::string const &filename) const { return transTable.save(filename, tableFormat); };
+
+            /**
+             * @brief Replace the transposition table with a snapshot saved by a Solver of the same board size.
+             * A snapshot of a table of the same size is mapped directly, so this returns immediately. Do not call this while solving.
+             * 
+             * @param filename (string) The snapshot file to load.
+             * @return (bool) Whether the snapshot was loaded. The table is unchanged if the file is missing or incompatible.
+             */
+            inline bool loadTable(std::string const &filename) { return transTable.load(filename, tableFormat); };
+
+            /**
+             * @brief Tell the solver that the positions it is asked about from now on follow a given position of the same game.
+             * The table keeps its entries, but those of positions with more empty cells than pos can no longer be reached, so
+             *  they are replaced first. Call reset instead when moving on to an unrelated position.
+             * 
+             * @param pos (Position) The current position of the game.
+             */
+            inline void advance(Position const &pos) { transTable.setMaxDepth(Position::cells - pos.getMoves()); };
 
             inline void reset() {
-                nodeCount = 0;
+                resetCounters();
+                resetOrdering();
                 transTable.reset();
             };
     };
+
+    // The board sizes the library is built for, see solver.cpp.
+    extern template class BasicSolver<7, 6>;
+    extern template class BasicSolver<6, 5>;
+    extern template class BasicSolver<6, 7>;
+    extern template class BasicSolver<8, 7>;
+
+    // Solver of the standard 7x6 board.
+    typedef BasicSolver<7, 6> Solver;
 }
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "solver.h"
+
+namespace IBN5100 {
+    /**
+     * @brief Serve solve and analyze requests with a pool of long-lived workers, each owning a Solver whose transposition
+     * table stays warm from one request to the next.
+     *
+     * Requests are lines of text and may be pipelined, any number of them being sent before the first response is read:
+     *  "[solve|weak|analyze] moves". A line that is only a move sequence is solved. Blank lines are ignored.
+     * Each request gets one response line starting with its index on the connection, from 0. Responses are written as
+     *  soon as they are ready, so they may come back out of order:
+     *  "index score nodes wait_us solve_us" for solve and weak, with one score per column for analyze ("-" for full
+     *  columns), "index invalid" when the move sequence is not a legal, unfinished game and "index error" when the
+     *  command is unknown. wait_us is the time the request spent queued and solve_us the time spent solving it.
+     *
+     */
+    class SolverServer {
+        private:
+            // Responses are handed to the connection's writer thread rather than written by the workers, so a client that
+            //  stops reading only ever blocks its own connection.
+            struct Connection {
+                int outFd;
+                std::mutex mutex;
+                std::condition_variable changed; // signalled when a response is queued or taken by the writer, or reading ends
+                std::string outbox; // responses waiting for the writer
+                uint64_t pending; // requests read but not yet answered
+                bool closing; // no more requests will be read
+            };
+
+            // The most bytes of responses waiting for a connection's writer. Past this, requests stop being read from the
+            //  connection until its client reads its responses.
+            static constexpr size_t outboxLimit = 1 << 20;
+
+            enum Command { SOLVE, WEAK, ANALYZE };
+
+            struct Job {
+                Connection* conn;
+                uint64_t index;
+                Command command;
+                std::string moves;
+                std::chrono::steady_clock::time_point received;
+            };
+
+            std::vector<std::unique_ptr<Solver>> solvers;
+            std::vector<std::thread> threads;
+            size_t queueSize; // maximum number of requests waiting for a worker, across every connection
+
+            std::mutex mutex;
+            std::condition_variable jobAvailable; // signalled when a job is queued or the server stops
+            std::condition_variable spaceAvailable; // signalled when a worker takes a job from the queue
+            std::deque<Job> jobs;
+            bool stopping;
+
+            std::atomic<int> listenFd;
+
+            void work(Solver* solver);
+
+            // Solve a job and return its response line.
+            std::string respond(Job const &job, Solver* solver);
+
+            // Write the responses of a connection as they are queued, until reading has ended and every request is answered.
+            void writeResponses(Connection &conn);
+
+            // Queue a response for the connection's writer. The caller must hold the connection's mutex.
+            static void queueResponse(Connection &conn, std::string const &response);
+
+            // Block until the queue has room, then queue the job.
+            void submit(Job &&job);
+
+        public:
+            /**
+             * @brief Construct a new SolverServer and start its workers.
+             *
+             * @param numThreads (uint) The number of worker threads. 0 uses one thread per hardware core.
+             * @param tableBytes (size_t) The memory budget of each worker's transposition table.
+             * @param queueSize (size_t) The maximum number of queued requests. 0 allows 4 per worker.
+             *  A connection that sends more stops being read until the workers catch up.
+             * @param openingBook (OpeningBook*) Optional opening book shared by every worker.
+             */
+            SolverServer(unsigned int numThreads = 0, size_t tableBytes = TransposeTable::defaultBytes,
+                size_t queueSize = 0, OpeningBook const* openingBook = nullptr);
+
+            SolverServer(SolverServer const&) = delete;
+            SolverServer &operator =(SolverServer const&) = delete;
+
+            ~SolverServer();
+
+            /**
+             * @brief Answer the requests read from a file descriptor until it reaches end of file.
+             * Returns once every request read has been answered and written. Several connections may be served at once.
+             * A client that does not read its responses stops only its own connection from being read, never the workers.
+             *
+             * @param inFd (int) The file descriptor requests are read from.
+             * @param outFd (int) The file descriptor responses are written to. It may be the same as inFd.
+             */
+            void serve(int inFd, int outFd);
+
+            /**
+             * @brief Accept connections on a Unix domain socket and serve each one on its own thread until stop is called.
+             * An existing socket file at the path is replaced.
+             *
+             * @param path (string) The path of the socket.
+             * @return (bool) 0 if the socket could not be created, 1 once the server is stopped.
+             */
+            bool listen(std::string const &path);
+
+            /**
+             * @brief Stop accepting connections and shut down the ones already accepted, making listen return once the
+             *  requests read from them are answered. Safe to call from a signal handler.
+             *
+             */
+            void stop();
+
+            inline unsigned int getNumThreads() const { return solvers.size(); };
+
+            // A worker's solver, for instance to snapshot or restore its transposition table. Not safe while serving.
+            inline Solver& getSolver(unsigned int i) { return *solvers[i]; };
+    };
+
+    /**
+     * @brief Connect to a Unix domain socket.
+     *
+     * @param path (string) The path of the socket.
+     * @return (int) The connected file descriptor, or -1 on failure.
+     */
+    int connectUnix(std::string const &path);
+}
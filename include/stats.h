@@ -0,0 +1,22 @@
+#pragma once
+
+// Search statistics are only counted when the library is built with IBN5100_STATS defined, so that the counters cost
+//  nothing in a regular build. IBN5100_COUNT increments a counter and compiles to nothing when statistics are disabled.
+#ifdef IBN5100_STATS
+
+    #define IBN5100_COUNT(counter) (++(counter))
+
+#else
+
+    #define IBN5100_COUNT(counter) ((void) 0)
+
+#endif
+
+namespace IBN5100 {
+    // Whether the library counts search statistics.
+#ifdef IBN5100_STATS
+    static constexpr bool statsEnabled = 1;
+#else
+    static constexpr bool statsEnabled = 0;
+#endif
+}
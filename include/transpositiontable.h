@@ -1,13 +1,27 @@
 #pragma once
 
+#include <atomic>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <cstring>
+#include <new>
+#include <string>
 #include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "position.h"
+#include "stats.h"
 
 namespace IBN5100 {
     // * ============================================================
-    // * Util functions to compute the next prime at compile time
+    // * Util functions to compute primes
     // * ============================================================
 
     static constexpr uint64_t med(uint64_t min, uint64_t max) { return (max + min)/2; };
@@ -22,30 +36,65 @@ namespace IBN5100 {
     // Return the next prime number greater than or equal to n (n >= 2)
     static constexpr uint64_t nextPrime(uint64_t n) { return hasFactor(n, 2, n) ? nextPrime(n+1) : n; };
 
+    // Return the previous prime number less than or equal to n (n >= 2)
+    static constexpr uint64_t prevPrime(uint64_t n) { return hasFactor(n, 2, n) ? prevPrime(n-1) : n; };
+
     static constexpr unsigned int log2(unsigned int n) { return n <= 1 ? 0 : log2(n/2) + 1; };
 
 
+    // The kind of memory pages backing a TranspositionTable.
+    enum class Pages {
+        Small, // regular pages, with transparent huge pages explicitly disabled
+        Transparent, // regular pages that the kernel is advised to back with transparent huge pages
+        Huge // explicit huge pages from the reserved pool, falling back to Transparent if none are available
+    };
+
     /**
      * @brief A collection of positions previously explored by our solver. This is used to avoid re-exploring the same position.
-     * It is stored as a HashMap with a fixed size. In case of collision, the last entry is kept and the previous one is overwritten.
-     * When storing the score, we differentiate if it's a lower bound, upper bound, or an absolute bound by adding or subtracting a 
-     * constant to the score. We have 3*(maxScore - minScore + 1) possibilities, which for 7x6 is 111. 111 - 18 = 93, so we store
-     * absolute bounds by adding 93. This makes absolute bound scores in [75, 111]. 74 - 18 = 56, so we store lower bounds by adding 56.
-     * This makes lower bound scores in [38, 74]. Further, 37 - 18 = 19, so we store upper bounds by adding 19. This makes upper bounds 
-     * scores in [1, 37]. Thus, we can differentiate between lower and upper bounds by checking if the score is above 37, and from
-     * absolute bounds by checking if the score is above 74. Note, it is important to not try to use rule of 5 operators (other than 
-     * the destructor) for this class as they are not implemented.
+     * It is stored as a HashMap whose size is chosen at runtime. When storing the score, we differentiate if it's a lower bound, upper bound, or an absolute bound by adding or
+     * subtracting a constant to the score. We have 3*(maxScore - minScore + 1) possibilities, which for 7x6 is 111. 111 - 18 = 93,
+     * so we store absolute bounds by adding 93. This makes absolute bound scores in [75, 111]. 74 - 18 = 56, so we store lower bounds
+     * by adding 56. This makes lower bound scores in [38, 74]. Further, 37 - 18 = 19, so we store upper bounds by adding 19. This
+     * makes upper bounds scores in [1, 37]. Thus, we can differentiate between lower and upper bounds by checking if the score is
+     * above 37, and from absolute bounds by checking if the score is above 74. Note, it is important to not try to use rule of 5
+     * operators (other than the destructor) for this class as they are not implemented.
+     * 
+     * Each entry packs the key and the value into a single 64-bit word: from the low bits up, the value, the depth of the position,
+     *  the generation the entry was stored in and the key. An entry is therefore read and written with one aligned access, so any
+     *  number of threads can probe and store concurrently without locks and a probe can never observe the key of one position with
+     *  the value of another.
+     * 
+     * Entries are grouped in buckets of 4, which share half a cache line. The number of buckets is the largest prime that fits in
+     *  the requested number of bytes. A key is stored in bucket key%buckets and only key/buckets is kept in the entry, as the two
+     *  together uniquely identify the key. A new position replaces, in order of preference, an entry left from a previous
+     *  generation or the entry with the lowest depth, so cheap positions near the leaves do not evict expensive ones near the root.
+     * 
+     * reset starts a new generation instead of clearing the entries, which makes entries of earlier generations invisible to probes
+     *  and free to replace. The entries are only actually cleared when the generation counter wraps around.
+     * The entries are allocated with an anonymous mmap so that they can be backed by huge pages, which greatly reduces the TLB
+     *  misses caused by random probes into a large table.
      * 
      * @tparam keySize (uint) Number of bits of the key.
      * @tparam valueSize (uint) Number of bits of the value.
-     * @tparam logSize (uint) Log2 of the size of the Transposition Table.
+     * @tparam depthSize (uint) Number of bits of the depth, used to decide which entry of a bucket to replace. With 0, only the
+     *  generation of the entries is considered.
      */
-    template<unsigned int keySize, unsigned int valueSize, unsigned int logSize>
+    template<unsigned int keySize, unsigned int valueSize, unsigned int depthSize = 0>
     class TranspositionTable {
         private:
             static_assert(keySize   <= 64, "keySize is too large");
-            static_assert(valueSize <= 64, "valueSize is too large");
-            static_assert(logSize   <= 64, "logSize is too large");
+            static_assert(valueSize + depthSize < 64, "valueSize and depthSize are too large");
+
+            static constexpr unsigned int bucketEntries = 4;
+
+            // Use up to 8 bits for the generation, as long as the smallest table that can hold the keys stays within 2^21
+            //  buckets (64MB).
+            static constexpr int spareBits = 85 - (int) (keySize + valueSize + depthSize);
+            static constexpr unsigned int genBits = spareBits < 1 ? 1 : spareBits > 8 ? 8 : spareBits;
+
+            // Everything below the key takes up tagShift bits, so keys wider than the space left need a minimum number of buckets.
+            static constexpr unsigned int tagShift = valueSize + depthSize + genBits;
+            static constexpr uint64_t minBuckets = keySize + tagShift > 64 ? 1ULL << (keySize + tagShift - 64) : 2;
 
             template<int S> using uint_t = 
                 typename std::conditional<S <= 8, uint_least8_t,
@@ -53,48 +102,205 @@ namespace IBN5100 {
                 typename std::conditional<S <= 32, uint_least32_t,
                                                     uint_least64_t>::type >::type >::type;
 
-            typedef uint_t<keySize - logSize> key_t;
             typedef uint_t<valueSize> value_t;
 
-            static constexpr uint64_t size = nextPrime(1ULL << logSize);
+            static constexpr uint64_t valueMask = (valueSize >= 64) ? ~0ULL : (1ULL << valueSize) - 1;
+            static constexpr uint64_t depthMask = (1ULL << depthSize) - 1;
+            static constexpr uint64_t genMask = (1ULL << genBits) - 1;
+            static constexpr size_t hugePageSize = 1ULL << 21;
 
-            key_t* keys;
-            value_t* values;
+            uint64_t buckets; // number of buckets
+            uint64_t size; // number of entries
+            uint64_t generation; // generation of the entries visible to probes, from 1 to genMask. Empty entries are generation 0.
+            unsigned int maxDepth; // entries with a greater depth can no longer be reached and are replaced first
+            void* map; // start of the mapping holding the entries
+            size_t length; // number of bytes mapped
+            Pages pages; // kind of pages actually backing the entries
+            std::atomic<uint64_t>* entries;
 
-            static constexpr size_t index(uint64_t key) { return key%size; };
+            // Header of a snapshot file. The entries follow at snapshotOffset, so that they can be mapped directly.
+            struct SnapshotHeader {
+                char magic[8];
+                uint32_t version;
+                uint32_t keyBits;
+                uint32_t valueBits;
+                uint32_t depthBits;
+                uint32_t entryBytes;
+                uint32_t bucketEntries;
+                uint64_t format; // identifies the encoding of the values, as given by the owner of the table
+                uint64_t buckets; // number of buckets
+                uint64_t generation; // generation of the entries that were visible when the snapshot was saved
+            };
 
-        public:
-            inline TranspositionTable() {
-                keys = new key_t[size];
-                values = new value_t[size];
-                reset();
+            static constexpr char snapshotMagic[8] = {'I', 'B', 'N', '5', '1', '0', '0', 'T'};
+            static constexpr uint32_t snapshotVersion = 2;
+            static constexpr size_t snapshotOffset = 1 << 12;
+
+        #ifdef IBN5100_STATS
+
+            // Statistics shared by every thread using the table, only present when built with IBN5100_STATS.
+            mutable std::atomic<uint64_t> probes{0}, hits{0}, overwrites{0};
+
+        #endif
+
+            // Map length bytes of anonymous memory backed by the requested kind of pages.
+            inline void allocate(Pages requested) {
+                void* mem = MAP_FAILED;
+                pages = requested;
+
+            #ifdef MAP_HUGETLB
+
+                if (pages == Pages::Huge) {
+                    mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                }
+
+            #endif
+
+                if (mem == MAP_FAILED) {
+                    if (pages == Pages::Huge) { pages = Pages::Transparent; }
+
+                    mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (mem == MAP_FAILED) { throw std::bad_alloc(); }
+
+                #if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+
+                    madvise(mem, length, pages == Pages::Small ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+
+                #endif
+                }
+
+                map = mem;
+                entries = static_cast<std::atomic<uint64_t>*>(mem);
+            };
+
+            // Set every entry to empty.
+            inline void clear() {
+                for (uint64_t i = 0; i < size; ++i) { entries[i].store(0, std::memory_order_relaxed); }
             };
 
-            inline ~TranspositionTable() {
-                delete[] keys;
-                delete[] values;
+            // Read the entries of a snapshot with a different number of buckets and add the ones of its last generation to this
+            //  table. The full key of an entry is recovered from its stored key/buckets and the index of its bucket.
+            inline bool rehash(int fd, uint64_t snapshotBuckets, uint64_t snapshotGeneration) {
+                constexpr size_t chunk = 1 << 16;
+                std::vector<uint64_t> buffer(chunk);
+                uint64_t snapshotSize = snapshotBuckets*bucketEntries;
+
+                for (uint64_t i = 0; i < snapshotSize; i += chunk) {
+                    size_t n = std::min<uint64_t>(chunk, snapshotSize - i);
+                    size_t bytes = n*sizeof(uint64_t);
+
+                    if (pread(fd, buffer.data(), bytes, snapshotOffset + i*sizeof(uint64_t)) != (ssize_t) bytes) { return 0; }
+
+                    for (size_t j = 0; j < n; ++j) {
+                        uint64_t entry = buffer[j];
+
+                        if (((entry >> (valueSize + depthSize)) & genMask) == snapshotGeneration) {
+                            uint64_t key = (entry >> tagShift)*snapshotBuckets + (i + j)/bucketEntries;
+                            add(key, entry & valueMask, (entry >> valueSize) & depthMask);
+                        }
+                    }
+                }
+
+                return 1;
+            };
+
+        public:
+            // The default size of the table, 64MB.
+            static constexpr size_t defaultBytes = 1ULL << 26;
+
+            /**
+             * @brief Construct a new, empty Transposition Table.
+             * 
+             * @param bytes (size_t) The memory budget of the table. The number of buckets is the largest prime that fits in it,
+             *              or the minimum number of buckets needed to store the keys if that is larger.
+             * @param requested (Pages) The kind of pages to back the table with.
+             */
+            inline TranspositionTable(size_t bytes = defaultBytes, Pages requested = Pages::Huge) : generation{1}, maxDepth{depthMask} {
+                buckets = std::max(prevPrime(std::max<uint64_t>(bytes/(bucketEntries*sizeof(uint64_t)), 2)), nextPrime(minBuckets));
+                size = buckets*bucketEntries;
+
+                // Round up to a whole number of huge pages so that the mapping can be backed by them.
+                length = (size*sizeof(uint64_t) + hugePageSize - 1) & ~(hugePageSize - 1);
+
+                allocate(requested);
+
+                // Anonymous mappings are already zeroed, but touching every page now keeps the page faults out of the first
+                //  searches, which would otherwise pay for them as reset no longer writes to the entries.
+                clear();
             };
 
+            inline ~TranspositionTable() { munmap(map, length); };
+
+            // Empty the table. This only starts a new generation, except once every genMask calls when the entries are cleared.
             inline void reset() {
-                std::memset(keys, 0, size*sizeof(key_t));
-                std::memset(values, 0, size*sizeof(value_t));
+                maxDepth = depthMask;
+
+                if (++generation > genMask) {
+                    clear();
+                    generation = 1;
+                }
             };
 
+            /**
+             * @brief Age out the entries deeper than a given depth, which can no longer be reached by the searches to come.
+             * They are still found by probes, but are replaced before any other entry of the current generation.
+             * This lasts until the next call or the next reset.
+             * 
+             * @param depth (uint) The greatest depth of the positions that will be searched.
+             */
+            inline void setMaxDepth(unsigned int depth) { maxDepth = depth; };
+
             /**
              * @brief Add a position with its score to the transposition table.
              * 
              * @param key (uint64) The position's unique key. Must be less than keySize bits.
              * @param value (value_t) The position's score. Must be less than valueSize bits.
+             * @param depth (uint) How expensive the position is to search, such as its number of empty cells. Entries with a lower
+             *              depth are replaced first. Must be less than depthSize bits.
              */
-            inline void add(uint64_t key, value_t value) {
-                assert(!(key >> keySize));
+            inline void add(uint64_t key, value_t value, unsigned int depth = 0) {
+                assert(keySize == 64 || !(key >> (keySize & 63)));
                 assert(!(value >> valueSize));
-                
-                size_t pos = index(key);
-                keys[pos] = key;
-                values[pos] = value;
+                assert(!(depth >> depthSize));
+
+                std::atomic<uint64_t>* bucket = entries + key%buckets*bucketEntries;
+                uint64_t tag = (key/buckets) << genBits | generation;
+
+                // Replace the entry of the same position if there is one, else a stale, aged out or empty entry, else the shallowest.
+                unsigned int victim = 0;
+                int victimDepth = INT_MAX;
+
+                for (unsigned int i = 0; i < bucketEntries; ++i) {
+                    uint64_t entry = bucket[i].load(std::memory_order_relaxed);
+
+                    if (entry >> (valueSize + depthSize) == tag) {
+                        victim = i;
+                        victimDepth = -2;
+                        break;
+                    }
+
+                    int entryDepth = (entry >> valueSize) & depthMask;
+                    if (((entry >> (valueSize + depthSize)) & genMask) != generation || entryDepth > (int) maxDepth) { entryDepth = -1; }
+
+                    if (entryDepth < victimDepth) {
+                        victim = i;
+                        victimDepth = entryDepth;
+                    }
+                }
+
+            #ifdef IBN5100_STATS
+
+                // Count the entries of other positions replaced by this one.
+                if (victimDepth >= 0) { overwrites.fetch_add(1, std::memory_order_relaxed); }
+
+            #endif
+
+                bucket[victim].store(tag << (valueSize + depthSize) | (uint64_t) depth << valueSize | value, std::memory_order_relaxed);
             };
 
+            // Start loading the bucket of a position into the cache, so that a probe or store soon after does not wait on memory.
+            inline void prefetch(uint64_t key) const { __builtin_prefetch(entries + key%buckets*bucketEntries); };
+
             /**
              * @brief Get the score from a position's unique key.
              * 
@@ -102,11 +308,188 @@ namespace IBN5100 {
              * @return (value_t) The position's score if present, 0 otherwise.
              */
             inline value_t operator [](uint64_t key) const {
-                assert(!(key >> keySize));
-                
-                size_t pos = index(key);
-                return keys[pos] == (key_t) key ? values[pos] : 0; // cast to key_t as keys[pos] may have been truncated
+                assert(keySize == 64 || !(key >> (keySize & 63)));
+
+                std::atomic<uint64_t> const* bucket = entries + key%buckets*bucketEntries;
+                uint64_t tag = (key/buckets) << genBits | generation;
+
+            #ifdef IBN5100_STATS
+
+                probes.fetch_add(1, std::memory_order_relaxed);
+
+            #endif
+
+                for (unsigned int i = 0; i < bucketEntries; ++i) {
+                    uint64_t entry = bucket[i].load(std::memory_order_relaxed);
+
+                    if (entry >> (valueSize + depthSize) == tag) {
+                    #ifdef IBN5100_STATS
+
+                        hits.fetch_add(1, std::memory_order_relaxed);
+
+                    #endif
+
+                        return entry & valueMask;
+                    }
+                }
+
+                return 0;
+            };
+
+            // Get the number of probes, the probes that found their position and the stores that replaced the entry of another
+            //  position since the last call to resetStats. These are always 0 unless the library is built with IBN5100_STATS.
+        #ifdef IBN5100_STATS
+
+            inline uint64_t getProbes() const { return probes.load(std::memory_order_relaxed); };
+            inline uint64_t getHits() const { return hits.load(std::memory_order_relaxed); };
+            inline uint64_t getOverwrites() const { return overwrites.load(std::memory_order_relaxed); };
+
+            inline void resetStats() {
+                probes.store(0, std::memory_order_relaxed);
+                hits.store(0, std::memory_order_relaxed);
+                overwrites.store(0, std::memory_order_relaxed);
+            };
+
+        #else
+
+            inline uint64_t getProbes() const { return 0; };
+            inline uint64_t getHits() const { return 0; };
+            inline uint64_t getOverwrites() const { return 0; };
+
+            inline void resetStats() {};
+
+        #endif
+
+            /**
+             * @brief Write every entry of the table to a snapshot file, which can later be loaded by a table of any size.
+             * The table must not be written to during the call.
+             * 
+             * @param filename (string) The file to write. It is replaced atomically, so a reader never sees a partial snapshot.
+             * @param format (uint64) Identifies the encoding of the values, which load requires to match.
+             * @return (bool) Whether the snapshot was written. Nothing is written if a file that is not a snapshot, or that
+             *  cannot be read, already exists at the path, so that a mistyped path never destroys an unrelated file.
+             */
+            inline bool save(std::string const &filename, uint64_t format) const {
+                int existing = ::open(filename.c_str(), O_RDONLY);
+                if (existing < 0 && errno != ENOENT) { return 0; }
+
+                if (existing >= 0) {
+                    char magic[sizeof(snapshotMagic)];
+                    bool snapshot = pread(existing, magic, sizeof(magic), 0) == (ssize_t) sizeof(magic) &&
+                        !std::memcmp(magic, snapshotMagic, sizeof(snapshotMagic));
+
+                    ::close(existing);
+                    if (!snapshot) { return 0; }
+                }
+
+                SnapshotHeader header{};
+                std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+                header.version = snapshotVersion;
+                header.keyBits = keySize;
+                header.valueBits = valueSize;
+                header.depthBits = depthSize;
+                header.entryBytes = sizeof(uint64_t);
+                header.bucketEntries = bucketEntries;
+                header.format = format;
+                header.buckets = buckets;
+                header.generation = generation;
+
+                std::string tmp = filename + ".tmp";
+                std::FILE* f = std::fopen(tmp.c_str(), "wb");
+                if (!f) { return 0; }
+
+                char padding[snapshotOffset] = {};
+                std::memcpy(padding, &header, sizeof(header));
+                bool ok = std::fwrite(padding, 1, snapshotOffset, f) == snapshotOffset;
+
+                // Copy the entries through a buffer as they are atomics.
+                constexpr size_t chunk = 1 << 16;
+                std::vector<uint64_t> buffer(chunk);
+
+                for (uint64_t i = 0; ok && i < size; i += chunk) {
+                    size_t n = std::min<uint64_t>(chunk, size - i);
+                    for (size_t j = 0; j < n; ++j) { buffer[j] = entries[i + j].load(std::memory_order_relaxed); }
+                    ok = std::fwrite(buffer.data(), sizeof(uint64_t), n, f) == n;
+                }
+
+                ok &= !std::fclose(f);
+
+                if (!ok || std::rename(tmp.c_str(), filename.c_str())) {
+                    std::remove(tmp.c_str());
+                    return 0;
+                }
+
+                return 1;
+            };
+
+            /**
+             * @brief Replace the entries of the table with the ones of a snapshot file.
+             * If the snapshot has as many buckets as the table, the file is mapped privately as the table's memory, so loading
+             *  is immediate and the entries are read from the page cache as they are probed. Changes are never written back to
+             *  the file. Note that the mapping uses regular pages. Otherwise, the entries of the snapshot's last generation are
+             *  read and added to this table.
+             * The table must not be used by other threads during the call.
+             * 
+             * @param filename (string) The snapshot to load.
+             * @param format (uint64) Identifies the encoding of the values, which must match the one the snapshot was saved with.
+             * @return (bool) Whether the snapshot was loaded. The table is left unchanged if the file is missing or does not hold
+             *  a snapshot of a table with the same key size, value size and format, and left empty if reading the entries fails.
+             */
+            inline bool load(std::string const &filename, uint64_t format) {
+                int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd < 0) { return 0; }
+
+                SnapshotHeader header;
+                struct stat st;
+
+                // ensure the file holds a snapshot of a table with the same geometry and encoding
+                if (fstat(fd, &st) || pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header) ||
+                    std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) || header.version != snapshotVersion ||
+                    header.keyBits != keySize || header.valueBits != valueSize || header.depthBits != depthSize ||
+                    header.entryBytes != sizeof(uint64_t) || header.bucketEntries != bucketEntries || header.format != format ||
+                    !header.buckets || !header.generation || header.generation > genMask ||
+                    (uint64_t) st.st_size < snapshotOffset + header.buckets*bucketEntries*sizeof(uint64_t)) {
+                    ::close(fd);
+                    return 0;
+                }
+
+                if (header.buckets == buckets && !(snapshotOffset % sysconf(_SC_PAGESIZE))) {
+                    size_t mapLength = snapshotOffset + size*sizeof(uint64_t);
+                    void* mem = mmap(nullptr, mapLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+                    if (mem != MAP_FAILED) {
+                        ::close(fd); // the mapping stays valid after the descriptor is closed
+
+                        munmap(map, length);
+                        map = mem;
+                        length = mapLength;
+                        pages = Pages::Small;
+                        entries = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(mem) + snapshotOffset);
+                        generation = header.generation;
+
+                        // Start reading the file in the background, as every page will soon be probed.
+                        madvise(map, length, MADV_WILLNEED);
+                        return 1;
+                    }
+                }
+
+                reset();
+                bool ok = rehash(fd, header.buckets, header.generation);
+                ::close(fd);
+
+                if (!ok) { reset(); }
+                return ok;
             };
+
+            // Get the number of entries in the table.
+            inline uint64_t getSize() const { return size; };
+
+            // Get the number of bytes used by the entries.
+            inline size_t getBytes() const { return size*sizeof(uint64_t); };
+
+            // Get the kind of pages backing the table. This can differ from the requested kind if huge pages were unavailable
+            //  or a snapshot was mapped.
+            inline Pages getPages() const { return pages; };
     };
 
 
@@ -114,5 +497,16 @@ namespace IBN5100 {
     // * Typedef for Default Transposition Table
     // * ===========================================
 
-    typedef TranspositionTable<49, log2(Position::maxScore - Position::minScore + 1) + 2, 23> TransposeTable;
+    // Number of bits of an encoded score bound, which is one of 3*(maxScore - minScore + 1) values above 0.
+    template<int width, int height>
+    static constexpr unsigned int boundBits = log2(3*(BasicPosition<width, height>::maxScore - BasicPosition<width, height>::minScore + 1)) + 1;
+
+    // Each value holds an encoded bound in its low boundBits bits and the best column + 1 above them, 0 meaning no move is known.
+    // The depth of an entry is the number of empty cells of its position.
+    template<int width, int height>
+    using BoardTransposeTable = TranspositionTable<BasicPosition<width, height>::keySize, boundBits<width, height> + log2(width) + 1,
+        log2(BasicPosition<width, height>::cells) + 1>;
+
+    static constexpr unsigned int boundSize = boundBits<7, 6>;
+    typedef BoardTransposeTable<7, 6> TransposeTable;
 }
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "../include/batchsolver.h"
+
+namespace IBN5100 {
+    BatchSolver::BatchSolver(unsigned int numThreads, size_t tableBytes, bool weak, OpeningBook const* openingBook) : weak{weak} {
+        if (!numThreads) { numThreads = std::max(std::thread::hardware_concurrency(), 1U); }
+
+        for (unsigned int i = 0; i < numThreads; ++i) { solvers.emplace_back(new Solver(openingBook, 1, tableBytes)); }
+
+        // Allow a few lines per thread to be queued so that no worker waits for the reader.
+        window = 4*numThreads;
+    };
+
+    void BatchSolver::work(Solver* solver, std::function<void(BatchResult const&)> const &onResult) {
+        while (1) {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAvailable.wait(lock, [&] { return !jobs.empty() || inputDone; });
+                if (jobs.empty()) { return; }
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            BatchResult result{job.index, job.moves, 0, 0, job.hasExpected, job.expected, 0, 0};
+
+            Position pos;
+            result.valid = pos.init(job.moves) == job.moves.length();
+
+            if (result.valid) {
+                auto start = std::chrono::steady_clock::now();
+                result.score = solver->solve(pos, weak);
+                result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                result.nodes = solver->getNodeCount();
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.emplace(result.index, std::move(result));
+
+            // Report every result that is now next in input order.
+            bool reported = 0;
+            for (auto it = finished.begin(); it != finished.end() && it->first == nextReport; it = finished.erase(it)) {
+                onResult(it->second);
+                ++nextReport;
+                reported = 1;
+            }
+
+            if (reported) { resultReported.notify_all(); }
+        }
+    };
+
+    void BatchSolver::run(std::istream &in, std::function<void(BatchResult const&)> const &onResult) {
+        jobs.clear();
+        finished.clear();
+        inputDone = 0;
+        nextReport = 0;
+
+        std::vector<std::thread> threads;
+        for (std::unique_ptr<Solver> const &solver : solvers) { threads.emplace_back(&BatchSolver::work, this, solver.get(), std::cref(onResult)); }
+
+        uint64_t index = 0;
+
+        for (std::string line; std::getline(in, line);) {
+            Job job{index, "", 0, 0};
+
+            std::istringstream ss(line);
+            if (!(ss >> job.moves)) { continue; } // blank line
+            job.hasExpected = (bool) (ss >> job.expected);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            resultReported.wait(lock, [&] { return index - nextReport < window; });
+
+            jobs.push_back(std::move(job));
+            ++index;
+            jobAvailable.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inputDone = 1;
+        }
+
+        jobAvailable.notify_all();
+        for (std::thread &t : threads) { t.join(); }
+    };
+}
@@ -1,61 +1,142 @@
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "../include/openingbook.h"
 
 namespace IBN5100 {
-    void OpeningBook::writeToFile(std::string const &filename, char* buffer, size_t bufferSize, uint16_t numPositions) {
-        // save the number of positions
-        size_t temp = 0; // just to allow us to serialize
-        serializePrimitive<uint16_t>(buffer, temp, numPositions);
-
-        // write the buffer to the file
-        std::fstream f(filename, std::fstream::binary | std::fstream::out | std::fstream::trunc);
-        f.write(buffer, bufferSize);
-        f.close();
-    };
+    void OpeningBook::open() {
+        int fd = ::open(filename.c_str(), O_RDONLY);
 
-    void OpeningBook::save(uint64_t key, int score) {
-        if (numPos == UINT16_MAX) { // ensure we do not add more positions than we can store
-            std::cout << "Max number of positions stored.\n"; // todo for debugging
+        if (fd < 0) {
+            invalid = errno != ENOENT; // a missing file is an empty book yet to be written
             return;
         }
 
-        serializePrimitive<uint64_t>(buffer, bufferSize, key);
-        serializePrimitive<int>(buffer, bufferSize, score);
+        struct stat st;
+        if (fstat(fd, &st) || (size_t) st.st_size < sizeof(Header)) {
+            ::close(fd);
+            invalid = 1;
+            return;
+        }
 
-        ++numPos;
-    };
+        void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping stays valid after the descriptor is closed
 
-    void OpeningBook::load(TransposeTable* t) {
-        std::fstream f(filename, std::fstream::binary | std::fstream::in);
+        if (mem == MAP_FAILED) {
+            invalid = 1;
+            return;
+        }
 
-        if (!f.is_open()) { // ensure the file exists
-            std::cout << "No opening book detected.\n"; // todo this is just for debugging, remove later
+        Header const* header = static_cast<Header const*>(mem);
+
+        // ensure the file holds a book of a format we understand
+        if (std::memcmp(header->magic, magic, sizeof(magic)) || header->version != version ||
+            header->numEntries > (st.st_size - sizeof(Header))/sizeof(uint64_t)) {
+            munmap(mem, st.st_size);
+            invalid = 1;
             return;
         }
 
-        // Load the data from the file into a buffer
-        std::vector<char> buf(std::istreambuf_iterator<char>(f), {});
-        size_t currentIndex = 0;
-        f.close();
+        map = mem;
+        mapLength = st.st_size;
+        entries = reinterpret_cast<uint64_t const*>(header + 1);
+        numEntries = header->numEntries;
+        maxMoves = header->maxMoves;
+
+        // The entries are binary searched, so the access pattern is random.
+        madvise(map, mapLength, MADV_RANDOM);
+    };
+
+    void OpeningBook::close() {
+        if (map) { munmap(map, mapLength); }
+
+        map = nullptr;
+        mapLength = 0;
+        entries = nullptr;
+        numEntries = 0;
+        maxMoves = -1;
+    };
 
-        // read in the number of stored positions
-        uint16_t numPositions = deserializePrimitive<uint16_t>(buf, currentIndex);
+    void OpeningBook::take(OpeningBook &other) {
+        filename = std::move(other.filename);
+        map = other.map;
+        mapLength = other.mapLength;
+        entries = other.entries;
+        numEntries = other.numEntries;
+        maxMoves = other.maxMoves;
+        pending = std::move(other.pending);
+        pendingMaxMoves = other.pendingMaxMoves;
+        invalid = other.invalid;
 
-        // add each position to our transposition table
-        for (uint16_t i = 0; i < numPositions; ++i) {
-            uint64_t key = deserializePrimitive<uint64_t>(buf, currentIndex);
-            int score = deserializePrimitive<int>(buf, currentIndex);
+        other.map = nullptr;
+        other.close();
+        other.pending.clear();
+        other.pendingMaxMoves = -1;
+    };
+
+    void OpeningBook::save(uint64_t key, int moves, int score) {
+        pending.push_back(encode(key, score));
+        pendingMaxMoves = std::max(pendingMaxMoves, moves);
+    };
+
+    bool OpeningBook::write() {
+        if (pending.empty()) { return 1; }
+        if (invalid) { return 0; }
 
-            // store the score as an absolute bound
-            t->add(key, score + 2*Position::maxScore - 3*Position::minScore + 3);
+        // Put the new entries after the existing ones so that a stable sort keeps them last among equal keys.
+        std::vector<uint64_t> merged(entries, entries + numEntries);
+        merged.insert(merged.end(), pending.begin(), pending.end());
 
-            // save the position to the opening book to prevent us from losing it
-            save(key, score);
+        std::stable_sort(merged.begin(), merged.end(), [](uint64_t a, uint64_t b) { return a >> 8 < b >> 8; });
+
+        // Keep only the latest entry of each key.
+        std::vector<uint64_t> book;
+        book.reserve(merged.size());
+
+        for (uint64_t entry : merged) {
+            if (!book.empty() && (book.back() >> 8) == (entry >> 8)) { book.back() = entry; }
+            else { book.push_back(entry); }
         }
 
-        std::cout << "Opening book loaded into transposition table.\n"; // todo also just for debugging
+        Header header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.maxMoves = std::max(maxMoves, pendingMaxMoves);
+        header.numEntries = book.size();
+
+        // Write to a temporary file and rename it over the book so that readers never see a partial book.
+        std::string tmp = filename + ".tmp";
+        std::fstream f(tmp, std::fstream::binary | std::fstream::out | std::fstream::trunc);
+        f.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        f.write(reinterpret_cast<char const*>(book.data()), book.size()*sizeof(uint64_t));
+        f.close();
+
+        if (!f || std::rename(tmp.c_str(), filename.c_str())) {
+            std::remove(tmp.c_str());
+            return 0; // keep the pending entries so that writing can be retried
+        }
+
+        pending.clear();
+        pendingMaxMoves = -1;
+
+        close();
+        open();
+        return 1;
+    };
+
+    bool OpeningBook::get(uint64_t key, int &score) const {
+        uint64_t const* it = std::lower_bound(entries, entries + numEntries, key << 8);
+        if (it == entries + numEntries || (*it >> 8) != key) { return 0; }
+
+        score = (int) (*it & 0xFF) + Position::minScore;
+        return 1;
     };
 }
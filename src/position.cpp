@@ -0,0 +1,84 @@
+#include <immintrin.h>
+
+// The vector instantiations of computeWinPos are only called from this file, by kernels compiled for the matching
+//  instruction set, so the ABI change GCC warns about when the library is not built for it does not matter.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+#include "../include/position.h"
+
+namespace IBN5100 {
+    // Bitboards of the columns, one per lane. Lanes past the last column are unused.
+    typedef uint64_t Lanes4 __attribute__((vector_size(32)));
+    typedef uint64_t Lanes8 __attribute__((vector_size(64)));
+
+    template<int width, int height>
+    void (*const BasicPosition<width, height>::scoreMoves)(uint64_t, uint64_t, uint64_t, int*, uint64_t*) = BasicPosition<width, height>::selectScoreMoves();
+
+    template<int width, int height>
+    void BasicPosition<width, height>::scoreMovesScalar(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]) {
+        for (int c = 0; c < width; ++c) {
+            if (uint64_t move = moves & columnMask(c)) {
+                moveWins[c] = computeWinPos(pos | move, mask);
+                scores[c] = __builtin_popcountll(moveWins[c]);
+            }
+        }
+    };
+
+    template<int width, int height>
+    __attribute__((target("avx2,popcnt")))
+    void BasicPosition<width, height>::scoreMovesAVX2(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]) {
+        Lanes4 low, high;
+
+        for (int c = 0; c < 4; ++c) {
+            low[c] = c < width ? columnMask(c) : 0;
+            high[c] = c + 4 < width ? columnMask(c + 4) : 0;
+        }
+
+        low = computeWinPos(pos | (low & moves), mask);
+        high = computeWinPos(pos | (high & moves), mask);
+
+        // AVX2 has no vector popcount, so the winning cells of each lane are counted with the scalar instruction.
+        for (int c = 0; c < 4 && c < width; ++c) {
+            moveWins[c] = low[c];
+            scores[c] = __builtin_popcountll(low[c]);
+        }
+
+        for (int c = 4; c < 8 && c < width; ++c) {
+            moveWins[c] = high[c - 4];
+            scores[c] = __builtin_popcountll(high[c - 4]);
+        }
+    };
+
+    template<int width, int height>
+    __attribute__((target("avx512f,avx512vpopcntdq")))
+    void BasicPosition<width, height>::scoreMovesAVX512(uint64_t pos, uint64_t mask, uint64_t moves, int scores[width], uint64_t moveWins[width]) {
+        Lanes8 cols;
+        for (int c = 0; c < 8; ++c) { cols[c] = c < width ? columnMask(c) : 0; }
+
+        Lanes8 win = computeWinPos(pos | (cols & moves), mask);
+
+        Lanes8 counts = (Lanes8) _mm512_popcnt_epi64((__m512i) win);
+        for (int c = 0; c < 8 && c < width; ++c) {
+            moveWins[c] = win[c];
+            scores[c] = counts[c];
+        }
+    };
+
+    template<int width, int height>
+    void (*BasicPosition<width, height>::selectScoreMoves())(uint64_t, uint64_t, uint64_t, int*, uint64_t*) {
+        // The vector kernels hold one column per lane, so wider boards are always scored one column at a time.
+        if (width > 8) { return scoreMovesScalar; }
+
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) { return scoreMovesAVX512; }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) { return scoreMovesAVX2; }
+        return scoreMovesScalar;
+    };
+
+    // The board sizes the library is built for. Other sizes need to be added here and in solver.cpp.
+    template class BasicPosition<7, 6>;
+    template class BasicPosition<6, 5>;
+    template class BasicPosition<6, 7>;
+    template class BasicPosition<8, 7>;
+}
@@ -1,115 +1,462 @@
 #include <iostream>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
 #include "../include/solver.h"
 
 namespace IBN5100 {
-    int Solver::negamax(Position const &pos, int alpha, int beta) {
+    /**
+     * @brief Order the columns by their distance to a point of the board, nearest first.
+     * 
+     * @param order (int*) Set to the columns in order.
+     * @param width (int) Number of columns of the board.
+     * @param centre (int) Twice the position of the point, so that it can lie between two columns.
+     * @param right (bool) Whether the right column comes first when two columns are as near.
+     */
+    static void centreOrder(int* order, int width, int centre, bool right) {
+        for (int i = 0; i < width; ++i) { order[i] = i; }
+
+        std::stable_sort(order, order + width, [=](int a, int b) {
+            int da = std::abs(2*a - centre), db = std::abs(2*b - centre);
+            return da < db || (da == db && (right ? a > b : a < b));
+        });
+    };
+
+    template<int width, int height>
+    BasicSolver<width, height>::BasicSolver(OpeningBook const* openingBook, unsigned int numThreads, size_t tableBytes, Pages pages)
+        : transTable(tableBytes, pages), book{standardBoard ? openingBook : nullptr} {
+        if (!numThreads) { numThreads = std::max(std::thread::hardware_concurrency(), 1U); }
+
+        workers.resize(numThreads);
+
+        // The primary worker explores the center columns first, while the first helpers favour different sides of the
+        //  board so that they fill different parts of the transposition table. Any further workers use a random column order.
+        for (unsigned int i = 0; i < numThreads; ++i) {
+            int* order = workers[i].colOrder;
+
+            if (i == 0) { centreOrder(order, width, width - 1, 1); }
+            else if (i == 1) { centreOrder(order, width, width - 1, 0); }
+            else if (i == 2) { centreOrder(order, width, width - 2, 0); }
+            else {
+                centreOrder(order, width, width, 1);
+                if (i > 3) { std::shuffle(order, order + width, std::mt19937(i)); }
+            }
+        }
+
+        reset();
+
+        for (unsigned int i = 1; i < numThreads; ++i) { helpers.emplace_back(&BasicSolver::help, this, std::ref(workers[i])); }
+    };
+
+    template<int width, int height>
+    BasicSolver<width, height>::~BasicSolver() {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            shuttingDown = 1;
+        }
+
+        probeReady.notify_all();
+        for (std::thread &t : helpers) { t.join(); }
+    };
+
+    template<int width, int height>
+    void BasicSolver<width, height>::resetOrdering() {
+        for (Worker &w : workers) {
+            std::fill(&w.history[0][0], &w.history[0][0] + 2*Position::keySize, 0);
+            std::fill(&w.killers[0][0], &w.killers[0][0] + (Position::cells + 1)*2, 0);
+        }
+    };
+
+    template<int width, int height>
+    int BasicSolver<width, height>::negamax(Worker &worker, Position const &pos, int alpha, int beta) {
         assert(alpha < beta);
         assert(!pos.canWinNext());
 
-        ++nodeCount;
+        // Another worker has already finished this search, so the result will be discarded.
+        if (stop.load(std::memory_order_relaxed)) { return 0; }
+
+        ++worker.nodeCount;
         int moves = pos.getMoves();
+        IBN5100_COUNT(worker.counters.nodesByPly[moves]);
 
         uint64_t possible = pos.nonLosingMoves();
 
-        if (!possible) { return -(42 - moves)/2; }
+        if (!possible) { return -(Position::cells - moves)/2; }
 
         // Check for a drawn game.
         // Since we have ruled out both us winning this turn and our opponent winning next move,
-        //  we only need to see if the total number of moves made is 40 or more.
-        if (moves >= 40) { return 0; }
+        //  we only need to see if the board is filled but for the last 2 cells.
+        if (moves >= Position::cells - 2) { return 0; }
+
+        // Switch to the specialized search for the last few cells.
+        if (Position::cells - moves <= endgameCells) {
+            --worker.nodeCount; // counted again by the endgame search
+            return endgameSearch(worker.nodeCount, worker.colOrder, pos, alpha, beta);
+        }
 
         // Compute the new minimum possible score since our opponent cannot win on their next move.
-        int min = -(40 - moves)/2;
+        int min = -(Position::cells - 2 - moves)/2;
         
         // Check if we need to update our lower bound.
         if (alpha < min) {
             alpha = min;
-            if (alpha >= beta) { return alpha; }
+
+            if (alpha >= beta) {
+                IBN5100_COUNT(worker.counters.minExits);
+                return alpha;
+            }
         }
 
         // Compute the maximum possible score as we cannot win on this move.
-        int max = (41 - moves)/2;
+        int max = (Position::cells - 1 - moves)/2;
 
         // Check if we need to update our upper bound.
         if (beta > max) {
             beta = max;
-            if (alpha >= beta) { return beta; }
+
+            if (alpha >= beta) {
+                IBN5100_COUNT(worker.counters.maxExits);
+                return beta;
+            }
+        }
+
+        // Check if the threats of the position already decide that we cannot win.
+        int bound = pos.claimevenBound();
+
+        if (beta > bound) {
+            beta = bound;
+
+            if (alpha >= beta) {
+                IBN5100_COUNT(worker.counters.threatExits);
+                return beta;
+            }
         }
 
         // Check if we have a position stored in our transposition table.
         // If we do, we will update the bounds accordingly.
-        uint64_t key = pos.key();
+        // The symmetric key is used so that a position and its mirror image share an entry.
+        uint64_t key = pos.symmetricKey();
+
+        // Shallow positions may have their exact score stored in the opening book.
+        if (standardBoard && book != nullptr && moves <= book->getMaxMoves()) {
+            int score;
+            if (book->get(key, score)) {
+                IBN5100_COUNT(worker.counters.bookHits);
+                return score;
+            }
+        }
+
+        // The best column is stored above the bound in the orientation of the symmetric key, so it has to be mirrored
+        //  when the position itself is the mirror image.
+        bool mirrored = key != pos.key();
+        int hashCol = -1; // column of the best move found by a previous search, or -1 if unknown
+
+        if (int entry = transTable[key]) {
+            int val = entry & ((1 << boundSize) - 1);
+
+            if (int col = entry >> boundSize) { hashCol = mirrored ? width - col : col - 1; }
 
-        if (int val = transTable[key]) {
             if (val > 2*(Position::maxScore - Position::minScore + 1)) { // we have an absolute bound
+                IBN5100_COUNT(worker.counters.exactHits);
                 return val - 2*Position::maxScore + 3*Position::minScore - 3; // decode and return the stored absolute bound
 
             } else if (val > Position::maxScore - Position::minScore + 1) { // we have a lower bound
                 min = val - Position::maxScore + 2*Position::minScore - 2; // decode the stored lower bound
+                IBN5100_COUNT(worker.counters.lowerHits);
 
                 // Check if we need to update our lower bound.
                 if (alpha < min) {
                     alpha = min;
-                    if (alpha >= beta) { return alpha; }
+
+                    if (alpha >= beta) {
+                        IBN5100_COUNT(worker.counters.lowerExits);
+                        return alpha;
+                    }
                 }
 
             } else { // we have an upper bound
                 max = val + Position::minScore - 1; // decode the stored upper bound
+                IBN5100_COUNT(worker.counters.upperHits);
 
                 // Check if we need to update our upper bound.
                 if (beta > max) {
                     beta = max;
-                    if (alpha >= beta) { return beta; }
+
+                    if (alpha >= beta) {
+                        IBN5100_COUNT(worker.counters.upperExits);
+                        return beta;
+                    }
                 }
             }
         }
 
-        MoveSorter movesOrder;
+        MoveSorter<width> movesOrder;
+        int side = moves & 1;
+        uint64_t* killers = worker.killers[moves];
+        int threats[width];
+        uint64_t moveWins[width];
+        pos.moveScores(possible, threats, moveWins);
+
+        // Children with endgameCells empty cells or fewer are searched by endgame and never stored in the table.
+        bool probeChildren = Position::cells - 1 - moves > endgameCells;
+        uint64_t childKeys[width];
+
+        // The move from the table is tried first, as it is the one that caused a cutoff last time.
+        // The rest are ordered by the threats they create, with killer moves and then the history breaking ties.
+        for (int i = 0; i < width; ++i) {
+            if (uint64_t move = possible & Position::columnMask(worker.colOrder[i])) {
+                int score = INT_MAX;
+
+                // Request the table entry of every child at once, so that their cache misses overlap instead of each
+                //  stalling the search in turn.
+                if (probeChildren) {
+                    Position pos2(pos);
+                    pos2.play(move, moveWins[worker.colOrder[i]]);
+
+                    childKeys[worker.colOrder[i]] = pos2.symmetricKey();
+                    transTable.prefetch(childKeys[worker.colOrder[i]]);
+                }
+
+                if (worker.colOrder[i] != hashCol) {
+                    score = threats[worker.colOrder[i]]*threatWeight + worker.history[side][__builtin_ctzll(move)];
+                    if (move == killers[0] || move == killers[1]) { score += killerWeight; }
+                }
+
+                movesOrder.add(move, score);
+            }
+        }
+
+        // Enhanced transposition cutoff: a child whose stored upper bound is low enough proves that its move reaches beta,
+        //  which ends the search without recursing into any child.
+        if (probeChildren) {
+            for (int col = 0; col < width; ++col) {
+                if (!(possible & Position::columnMask(col))) { continue; }
+
+                int val = transTable[childKeys[col]] & ((1 << boundSize) - 1);
+                int score;
+
+                if (val > 2*(Position::maxScore - Position::minScore + 1)) { score = -(val - 2*Position::maxScore + 3*Position::minScore - 3); }
+                else if (val && val <= Position::maxScore - Position::minScore + 1) { score = -(val + Position::minScore - 1); }
+                else { continue; } // no entry or a lower bound, which only limits the score of the move from above
 
-        for (int i = 0; i < 7; ++i) {
-            if (uint64_t move = possible & Position::columnMask(colOrder[i])) {
-                movesOrder.add(move, pos.moveScore(move));
+                if (score >= beta) {
+                    IBN5100_COUNT(worker.counters.etcExits);
+
+                    int storedCol = (mirrored ? width - 1 - col : col) + 1;
+                    transTable.add(key, (score + Position::maxScore - 2*Position::minScore + 2) | storedCol << boundSize, Position::cells - moves);
+                    return score;
+                }
             }
         }
 
+        int bestCol = hashCol, bestScore = INT_MIN, searched = 0;
+        ++worker.stats.nodes;
+
         // Simulate each possible move.
         // The max score from all the possible moves is the score of the current position.
         while (uint64_t move = movesOrder.getNext()) {
+            int col = Position::moveColumn(move);
+
             Position pos2(pos);
-            pos2.play(move);
+            pos2.play(move, moveWins[col]);
 
             // The score of the move would be equal to the negative score of the move for the opponent. 
-            int score = -negamax(pos2, -beta, -alpha);
+            int score = -negamax(worker, pos2, -beta, -alpha);
+
+            // Do not store anything from an interrupted search as the score is meaningless.
+            if (stop.load(std::memory_order_relaxed)) { return 0; }
+
+            int storedCol = (mirrored ? width - 1 - col : col) + 1;
+            ++searched;
 
             // If the score is greater than or equal to the upper bound, we know we have found the best possible score.
             if (score >= beta) {
-                // Save this as the lower bound of the position.
-                transTable.add(key, score + Position::maxScore - 2*Position::minScore + 2);
+                ++worker.stats.cutoffs;
+                worker.stats.firstMoveCutoffs += searched == 1;
+                worker.stats.cutoffMoves += searched;
+                IBN5100_COUNT(worker.counters.cutoffsByMove[searched - 1]);
+
+                // Remember the move for the siblings of this position and for the positions sharing its cells.
+                if (move != killers[0]) {
+                    killers[1] = killers[0];
+                    killers[0] = move;
+                }
+
+                int &history = worker.history[side][__builtin_ctzll(move)];
+                history += Position::cells - moves;
+
+                // Halve the history of the player once it gets too large so that it stays below the killer weight
+                //  and recent cutoffs count for more than old ones.
+                if (history > maxHistory) {
+                    for (int &h : worker.history[side]) { h >>= 1; }
+                }
+
+                // Save this as the lower bound of the position along with the move that caused the cutoff.
+                transTable.add(key, (score + Position::maxScore - 2*Position::minScore + 2) | storedCol << boundSize, Position::cells - moves);
                 return score;
             }
 
+            // Keep the previous best move, if any, as it is usually still the best one when every move fails low.
+            if (hashCol < 0 && score > bestScore) {
+                bestCol = col;
+                bestScore = score;
+            }
+
             // Update our lower bound if needed.
             if (alpha < score) { alpha = score; }
         }
 
         // Save this as the upper bound of our position.
-        transTable.add(key, alpha - Position::minScore + 1);
+        int storedCol = bestCol < 0 ? 0 : (mirrored ? width - 1 - bestCol : bestCol) + 1;
+        transTable.add(key, (alpha - Position::minScore + 1) | storedCol << boundSize, Position::cells - moves);
         return alpha;
     };
 
-    int Solver::solve(Position const &pos, bool weak) {
-        nodeCount = 0;
+    template<int width, int height>
+    template<int empty>
+    int BasicSolver<width, height>::endgame(uint64_t &nodes, int const* colOrder, Position const &pos, int alpha, int beta) {
+        assert(alpha < beta);
+        assert(!pos.canWinNext());
+        assert(pos.getMoves() == Position::cells - empty);
+
+        ++nodes;
+        uint64_t possible = pos.nonLosingMoves();
+
+        if (!possible) { return -empty/2; }
+
+        if constexpr (empty <= 2) { return 0; }
+        else {
+            // The same bounds as negamax, which are all constants here.
+            constexpr int min = -(empty - 2)/2, max = (empty - 1)/2;
+
+            if (alpha < min) {
+                alpha = min;
+                if (alpha >= beta) { return alpha; }
+            }
+
+            if (beta > max) {
+                beta = max;
+                if (alpha >= beta) { return beta; }
+            }
+
+            // Every column can only have an even number of empty cells when the total is even.
+            if constexpr (!(empty & 1)) {
+                int bound = pos.claimevenBound();
+
+                if (beta > bound) {
+                    beta = bound;
+                    if (alpha >= beta) { return beta; }
+                }
+            }
+
+            // The winning cells of every move are computed at once, which is cheaper than one move at a time even when a cutoff
+            //  leaves some of them unused.
+            int threats[width];
+            uint64_t moveWins[width];
+            pos.moveScores(possible, threats, moveWins);
+
+            for (int i = 0; i < width; ++i) {
+                if (uint64_t move = possible & Position::columnMask(colOrder[i])) {
+                    Position pos2(pos);
+                    pos2.play(move, moveWins[colOrder[i]]);
+
+                    int score = -endgame<empty - 1>(nodes, colOrder, pos2, -beta, -alpha);
+
+                    if (score >= beta) { return score; }
+                    if (alpha < score) { alpha = score; }
+                }
+            }
+
+            return alpha;
+        }
+    };
+
+    template<int width, int height>
+    template<int empty>
+    int BasicSolver<width, height>::endgameSearch(uint64_t &nodes, int const* colOrder, Position const &pos, int alpha, int beta) {
+        if constexpr (empty > 0) {
+            if (Position::cells - pos.getMoves() < empty) { return endgameSearch<empty - 1>(nodes, colOrder, pos, alpha, beta); }
+        }
+
+        return endgame<empty>(nodes, colOrder, pos, alpha, beta);
+    };
+
+    template<int width, int height>
+    void BasicSolver<width, height>::runProbe(Worker &worker) {
+        int score = negamax(worker, probePos, probeAlpha, probeBeta);
+
+        // Only a worker that never saw stop set can win the exchange, so the published score is always exact.
+        if (!stop.exchange(1)) { probeResult = score; }
+    };
+
+    template<int width, int height>
+    void BasicSolver<width, height>::help(Worker &worker) {
+        uint64_t seen = 0;
+
+        while (1) {
+            {
+                std::unique_lock<std::mutex> lock(poolMutex);
+                probeReady.wait(lock, [&] { return probeIndex != seen || shuttingDown; });
+                if (shuttingDown) { return; }
+
+                seen = probeIndex;
+            }
+
+            runProbe(worker);
+
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (!--running) { probeDone.notify_one(); }
+        }
+    };
+
+    template<int width, int height>
+    int BasicSolver<width, height>::search(Position const &pos, int alpha, int beta) {
+        resetStop();
+        if (helpers.empty()) { return negamax(workers[0], pos, alpha, beta); }
+
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            probePos = pos;
+            probeAlpha = alpha;
+            probeBeta = beta;
+            probeResult = 0;
+            running = helpers.size();
+            ++probeIndex;
+        }
+
+        probeReady.notify_all();
+        runProbe(workers[0]);
+
+        // Wait for every helper to stop so that the workers are idle between probes and their counts can be read.
+        std::unique_lock<std::mutex> lock(poolMutex);
+        probeDone.wait(lock, [&] { return !running; });
+        return probeResult;
+    };
+
+    template<int width, int height>
+    SolveProgress BasicSolver<width, height>::solveScore(Position const &pos, bool weak, ProgressCallback const &onProgress) {
+        SolveProgress window{0, 0, getNodeCount(), 0};
+        int &min = window.min, &max = window.max;
 
-        if (pos.canWinNext()) { return (43 - pos.getMoves())/2; }
+        if (pos.canWinNext()) {
+            min = max = (Position::cells + 1 - pos.getMoves())/2;
+            if (onProgress) { onProgress(window); }
+            return window;
+        }
 
-        int min = -(42 - pos.getMoves())/2;
-        int max = (43 - pos.getMoves())/2 - 1; // subtract 1 as we cannot win this turn
+        min = -(Position::cells - pos.getMoves())/2;
+        max = (Position::cells + 1 - pos.getMoves())/2 - 1; // subtract 1 as we cannot win this turn
 
         if (weak) {
             min = -1;
             max = 1;
         }
 
+        if (onProgress) { onProgress(window); }
+
         // iteratively narrow the search window with a modified version of binary search
         while (min < max) {
             int med = min + (max - min)/2;
@@ -119,13 +466,283 @@ namespace IBN5100 {
 
             // Use a search window of depth 1 to see if the actual score is less than or greater than med.
             // From this result, we can then modify the min or max accordingly.
-            int temp = negamax(pos, med, med + 1);
+            int temp = search(pos, med, med + 1);
+
+            // The helper threads are idle by now, so their node counts can be read.
+            window.nodes = getNodeCount();
+
+            // A cancelled probe was interrupted, so its result says nothing about the score.
+            window.cancelled = cancelled.load(std::memory_order_relaxed);
+            if (window.cancelled) { break; }
 
             // update the min and max accordingly
             if (temp <= med) { max = temp; }
             else { min = temp; }
+
+            if (onProgress) { onProgress(window); }
+        }
+
+        if (window.cancelled && onProgress) { onProgress(window); }
+        return window;
+    };
+
+    template<int width, int height>
+    int BasicSolver<width, height>::solve(Position const &pos, bool weak) {
+        cancelled.store(0);
+        resetCounters();
+        return solveScore(pos, weak).min;
+    };
+
+    template<int width, int height>
+    std::future<SolveProgress> BasicSolver<width, height>::solveAsync(Position const &pos, bool weak, ProgressCallback onProgress) {
+        // Cleared here rather than on the solving thread so that a cancel made as soon as this returns is never lost.
+        cancelled.store(0);
+
+        return std::async(std::launch::async, [this, pos, weak, onProgress = std::move(onProgress)] {
+            resetCounters();
+            return solveScore(pos, weak, onProgress);
+        });
+    };
+
+    template<int width, int height>
+    std::array<int, width> BasicSolver<width, height>::analyze(Position const &pos, bool weak) {
+        cancelled.store(0);
+        resetCounters();
+
+        std::array<int, width> scores;
+
+        // Solve the children in column order without clearing the transposition table in between.
+        // Siblings share most of their subtrees, so every child after the first is mostly answered from the table.
+        for (int i = 0; i < width; ++i) {
+            int c = workers[0].colOrder[i];
+
+            if (!pos.canPlay(c)) {
+                scores[c] = invalidMove;
+                continue;
+            }
+
+            if (pos.isWin(c)) {
+                scores[c] = (Position::cells + 1 - pos.getMoves())/2;
+                continue;
+            }
+
+            Position pos2(pos);
+            pos2.playCol(c);
+
+            scores[c] = -solveScore(pos2, weak).min;
+        }
+
+        return scores;
+    };
+
+    template<int width, int height>
+    std::string BasicSolver<width, height>::principalVariation(Position const &pos) const {
+        std::string moves;
+        Position p(pos);
+
+        while (p.getMoves() < Position::cells) {
+            // A winning move ends the line. It is never stored, as negamax is not called on positions with one.
+            if (p.canWinNext()) {
+                for (int c = 0; c < width; ++c) {
+                    if (p.canPlay(c) && p.isWin(c)) {
+                        moves += '1' + c;
+                        break;
+                    }
+                }
+
+                break;
+            }
+
+            // The endgame is searched without the table, so its best moves are found again by solving every move.
+            if (Position::cells - p.getMoves() <= endgameCells) {
+                int col = -1, best = INT_MIN;
+                uint64_t nodes = 0;
+
+                for (int c = 0; c < width; ++c) {
+                    if (!p.canPlay(c)) { continue; }
+
+                    Position p2(p);
+                    p2.playCol(c);
+
+                    int score = p2.canWinNext() ? -(Position::cells + 1 - p2.getMoves())/2 :
+                        -endgameSearch(nodes, workers[0].colOrder, p2, Position::minScore, Position::maxScore);
+
+                    if (score > best) {
+                        col = c;
+                        best = score;
+                    }
+                }
+
+                moves += '1' + col;
+                p.playCol(col);
+                continue;
+            }
+
+            uint64_t key = p.symmetricKey();
+            int col = transTable[key] >> boundSize;
+            if (!col) { break; }
+
+            col = key != p.key() ? width - col : col - 1;
+            if (!p.canPlay(col)) { break; }
+
+            moves += '1' + col;
+            p.playCol(col);
+        }
+
+        return moves;
+    };
+
+    template<int width, int height>
+    int BasicSolver<width, height>::heuristic(Position const &pos) {
+        int estimate = 16*(pos.threatCount() - pos.oppThreatCount());
+        return std::max(-provenScale + 1, std::min(estimate, provenScale - 1));
+    };
+
+    template<int width, int height>
+    int BasicSolver<width, height>::negamaxDepth(Worker &worker, Position const &pos, int alpha, int beta, int depth) {
+        assert(alpha < beta);
+        assert(!pos.canWinNext());
+
+        // Only check the clock every so often as it is much slower than searching a node.
+        if (!(++worker.nodeCount & 1023) && std::chrono::steady_clock::now() >= deadline) { stop.store(1, std::memory_order_relaxed); }
+        if (stop.load(std::memory_order_relaxed)) { return 0; }
+
+        int moves = pos.getMoves();
+        uint64_t possible = pos.nonLosingMoves();
+
+        if (!possible) { return -(Position::cells - moves)/2*provenScale; }
+        if (moves >= Position::cells - 2) { return 0; }
+        if (!depth) { return heuristic(pos); }
+
+        // Exact scores are known for the positions in the opening book and for the absolute bounds of the transposition table.
+        // Other bounds are not used since they cannot be compared with estimates.
+        uint64_t key = pos.symmetricKey();
+
+        if (standardBoard && book != nullptr && moves <= book->getMaxMoves()) {
+            int score;
+            if (book->get(key, score)) { return score*provenScale; }
+        }
+
+        int val = transTable[key] & ((1 << boundSize) - 1);
+        if (val > 2*(Position::maxScore - Position::minScore + 1)) { return (val - 2*Position::maxScore + 3*Position::minScore - 3)*provenScale; }
+
+        MoveSorter<width> movesOrder;
+        int threats[width];
+        uint64_t moveWins[width];
+        pos.moveScores(possible, threats, moveWins);
+
+        // Moves with equal scores are taken last in first out, so add them from the edges in to try the centre first.
+        for (int i = width - 1; i >= 0; --i) {
+            if (uint64_t move = possible & Position::columnMask(worker.colOrder[i])) {
+                movesOrder.add(move, threats[worker.colOrder[i]]);
+            }
+        }
+
+        while (uint64_t move = movesOrder.getNext()) {
+            Position pos2(pos);
+            pos2.play(move, moveWins[Position::moveColumn(move)]);
+
+            int score = -negamaxDepth(worker, pos2, -beta, -alpha, depth - 1);
+            if (stop.load(std::memory_order_relaxed)) { return 0; }
+
+            if (score >= beta) { return score; }
+            if (alpha < score) { alpha = score; }
         }
 
-        return min;
+        return alpha;
     };
+
+    template<int width, int height>
+    Evaluation BasicSolver<width, height>::evaluate(Position const &pos, std::chrono::milliseconds timeLimit) {
+        cancelled.store(0);
+        resetCounters();
+
+        Evaluation result{-1, 0, 1, 0};
+        int moves = pos.getMoves();
+
+        if (pos.canWinNext()) {
+            for (int c = 0; c < width; ++c) {
+                if (pos.canPlay(c) && pos.isWin(c)) {
+                    result.move = c;
+                    break;
+                }
+            }
+
+            result.score = (Position::cells + 1 - moves)/2;
+            return result;
+        }
+
+        uint64_t possible = pos.nonLosingMoves();
+
+        // Every move loses, so any playable column will do.
+        if (!possible) {
+            for (int c = 0; c < width && result.move < 0; ++c) {
+                if (pos.canPlay(c)) { result.move = c; }
+            }
+
+            result.score = -(Position::cells - moves)/2;
+            return result;
+        }
+
+        Worker &worker = workers[0];
+        deadline = std::chrono::steady_clock::now() + timeLimit;
+        resetStop();
+
+        int threats[width];
+        uint64_t moveWins[width];
+        pos.moveScores(possible, threats, moveWins);
+
+        // Once every line has been searched to the end of the game, deeper searches cannot change the score.
+        for (int depth = 1; depth <= Position::cells - moves; ++depth) {
+            MoveSorter<width> movesOrder;
+
+            // Start with the best move of the previous search so that the rest of the moves are cut off sooner.
+            for (int i = width - 1; i >= 0; --i) {
+                int c = worker.colOrder[i];
+                if (uint64_t move = possible & Position::columnMask(c)) { movesOrder.add(move, c == result.move ? INT_MAX : threats[c]); }
+            }
+
+            int alpha = -(Position::cells - moves)/2*provenScale - 1, bestMove = -1;
+
+            while (uint64_t move = movesOrder.getNext()) {
+                Position pos2(pos);
+                pos2.play(move, moveWins[Position::moveColumn(move)]);
+
+                int score = -negamaxDepth(worker, pos2, -(Position::cells + 1 - moves)/2*provenScale - 1, -alpha, depth - 1);
+
+                // The first search is always completed so that there is a move to return.
+                if (stop.load(std::memory_order_relaxed) && result.depth) { break; }
+
+                if (score > alpha) {
+                    alpha = score;
+                    bestMove = Position::moveColumn(move);
+                }
+            }
+
+            if (stop.load(std::memory_order_relaxed) && result.depth) { break; }
+            resetStop();
+
+            result.move = bestMove;
+            result.depth = depth;
+
+            // A score beyond provenScale can only come from lines that all end the game within the search depth, and any
+            //  faster win would have been found at a shallower depth, so it is exact.
+            result.proven = alpha >= provenScale || alpha <= -provenScale || depth == Position::cells - moves;
+            result.score = result.proven ? alpha/provenScale : alpha;
+
+            if (result.proven || std::chrono::steady_clock::now() >= deadline) { break; }
+        }
+
+        // The search that ran out of time leaves stop set, which would otherwise end the next search before it starts.
+        stop.store(0, std::memory_order_relaxed);
+        return result;
+    };
+
+    template<int width, int height>
+    typename BasicSolver<width, height>::TransposeTable const &BasicSolver<width, height>::getTransTable() const { return transTable; };
+
+    template class BasicSolver<7, 6>;
+    template class BasicSolver<6, 5>;
+    template class BasicSolver<6, 7>;
+    template class BasicSolver<8, 7>;
 }
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <set>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../include/solverserver.h"
+
+namespace IBN5100 {
+    // Write the whole buffer, retrying partial writes. Returns 0 on an error, such as a client that went away.
+    static bool writeAll(int fd, char const* buf, size_t len) {
+        while (len) {
+            ssize_t n = write(fd, buf, len);
+
+            if (n < 0) {
+                if (errno == EINTR) { continue; }
+                return 0;
+            }
+
+            buf += n;
+            len -= n;
+        }
+
+        return 1;
+    };
+
+    SolverServer::SolverServer(unsigned int numThreads, size_t tableBytes, size_t queueSize, OpeningBook const* openingBook)
+        : queueSize{queueSize}, stopping{0}, listenFd{-1} {
+        if (!numThreads) { numThreads = std::max(std::thread::hardware_concurrency(), 1U); }
+        if (!this->queueSize) { this->queueSize = 4*numThreads; }
+
+        for (unsigned int i = 0; i < numThreads; ++i) { solvers.emplace_back(new Solver(openingBook, 1, tableBytes)); }
+        for (std::unique_ptr<Solver> const &solver : solvers) { threads.emplace_back(&SolverServer::work, this, solver.get()); }
+    };
+
+    SolverServer::~SolverServer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = 1;
+        }
+
+        jobAvailable.notify_all();
+        for (std::thread &t : threads) { t.join(); }
+    };
+
+    void SolverServer::submit(Job &&job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceAvailable.wait(lock, [&] { return jobs.size() < queueSize; });
+
+        jobs.push_back(std::move(job));
+        jobAvailable.notify_one();
+    };
+
+    void SolverServer::work(Solver* solver) {
+        while (1) {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAvailable.wait(lock, [&] { return !jobs.empty() || stopping; });
+                if (jobs.empty()) { return; }
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            spaceAvailable.notify_one();
+            std::string response = respond(job, solver);
+
+            // The connection may be destroyed as soon as its last request is answered and its lock is released, so it is
+            //  not touched after this.
+            Connection* conn = job.conn;
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            queueResponse(*conn, response);
+            --conn->pending;
+        }
+    };
+
+    void SolverServer::queueResponse(Connection &conn, std::string const &response) {
+        conn.outbox += response;
+        conn.changed.notify_all();
+    };
+
+    void SolverServer::writeResponses(Connection &conn) {
+        std::string buffer;
+        bool broken = 0; // the client went away, so the rest of the responses are dropped
+
+        while (1) {
+            {
+                std::unique_lock<std::mutex> lock(conn.mutex);
+                conn.changed.wait(lock, [&] { return !conn.outbox.empty() || (conn.closing && !conn.pending); });
+                if (conn.outbox.empty()) { return; }
+
+                buffer.swap(conn.outbox);
+                conn.changed.notify_all(); // the reader may be waiting for room
+            }
+
+            if (!broken) { broken = !writeAll(conn.outFd, buffer.data(), buffer.size()); }
+            buffer.clear();
+        }
+    };
+
+    std::string SolverServer::respond(Job const &job, Solver* solver) {
+        auto start = std::chrono::steady_clock::now();
+        std::string response = std::to_string(job.index);
+
+        Position pos;
+
+        if (pos.init(job.moves) != job.moves.length()) { response += " invalid"; }
+        else {
+            if (job.command == ANALYZE) {
+                for (int score : solver->analyze(pos)) {
+                    response += score == Solver::invalidMove ? " -" : " " + std::to_string(score);
+                }
+            } else { response += " " + std::to_string(solver->solve(pos, job.command == WEAK)); }
+
+            auto end = std::chrono::steady_clock::now();
+            response += " " + std::to_string(solver->getNodeCount());
+            response += " " + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(start - job.received).count());
+            response += " " + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        }
+
+        return response + '\n';
+    };
+
+    void SolverServer::serve(int inFd, int outFd) {
+        Connection conn;
+        conn.outFd = outFd;
+        conn.pending = 0;
+        conn.closing = 0;
+
+        std::thread writer(&SolverServer::writeResponses, this, std::ref(conn));
+
+        uint64_t index = 0;
+        std::string buffer;
+        char chunk[4096];
+
+        while (1) {
+            ssize_t n = read(inFd, chunk, sizeof(chunk));
+
+            if (n < 0 && errno == EINTR) { continue; }
+            if (n <= 0) { break; }
+
+            buffer.append(chunk, n);
+
+            size_t start = 0;
+            for (size_t end; (end = buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+                std::istringstream ss(buffer.substr(start, end - start));
+                std::string word;
+                if (!(ss >> word)) { continue; } // blank line
+
+                Job job{&conn, index++, SOLVE, "", std::chrono::steady_clock::now()};
+                bool known = 1;
+
+                if (word == "solve" || word == "weak" || word == "analyze") {
+                    job.command = word == "solve" ? SOLVE : word == "weak" ? WEAK : ANALYZE;
+                    ss >> job.moves; // no move sequence is the starting position
+                } else if (word.find_first_not_of("0123456789") == std::string::npos) { job.moves = word; }
+                else { known = 0; }
+
+                {
+                    // Stop reading while the client is not reading its responses.
+                    std::unique_lock<std::mutex> lock(conn.mutex);
+                    conn.changed.wait(lock, [&] { return conn.outbox.size() < outboxLimit; });
+
+                    // An unknown command or anything after the move sequence is answered right away.
+                    if (!known || ss >> word) {
+                        queueResponse(conn, std::to_string(job.index) + " error\n");
+                        continue;
+                    }
+
+                    ++conn.pending;
+                }
+
+                submit(std::move(job));
+            }
+
+            buffer.erase(0, start);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            conn.closing = 1;
+            conn.changed.notify_all();
+        }
+
+        // The writer returns once every request read is answered and written.
+        writer.join();
+    };
+
+    bool SolverServer::listen(std::string const &path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) { return 0; }
+        std::strcpy(addr.sun_path, path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) { return 0; }
+
+        unlink(path.c_str());
+
+        if (bind(fd, (sockaddr*) &addr, sizeof(addr)) || ::listen(fd, 64)) {
+            close(fd);
+            return 0;
+        }
+
+        listenFd = fd;
+
+        std::mutex connMutex;
+        std::condition_variable connDone;
+        std::set<int> clients; // the connections being served
+
+        while (1) {
+            int client = accept(fd, nullptr, nullptr);
+
+            if (client < 0) {
+                if (errno == EINTR && listenFd >= 0) { continue; }
+                break; // stopped
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(connMutex);
+                clients.insert(client);
+            }
+
+            std::thread([&, client] {
+                serve(client, client);
+
+                // The descriptor leaves the set before it is closed, so that its number is never shut down once reused.
+                std::lock_guard<std::mutex> lock(connMutex);
+                clients.erase(client);
+                close(client);
+                if (clients.empty()) { connDone.notify_all(); }
+            }).detach();
+        }
+
+        // Shut the open connections down so that idle clients do not hold the server up. Their reads end as if the client had
+        //  closed the connection, and the requests already read are still answered, though the responses can no longer be sent.
+        std::unique_lock<std::mutex> lock(connMutex);
+        for (int client : clients) { shutdown(client, SHUT_RDWR); }
+        connDone.wait(lock, [&] { return clients.empty(); });
+
+        close(fd);
+        unlink(path.c_str());
+        return 1;
+    };
+
+    void SolverServer::stop() {
+        int fd = listenFd.exchange(-1);
+        if (fd >= 0) { shutdown(fd, SHUT_RDWR); }
+    };
+
+    int connectUnix(std::string const &path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) { return -1; }
+        std::strcpy(addr.sun_path, path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) { return -1; }
+
+        if (connect(fd, (sockaddr*) &addr, sizeof(addr))) {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    };
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../include/batchsolver.h"
+
+// Solve a stream of "moves [expected-score]" lines from a file or stdin with a pool of threads.
+// Each result is printed in input order as "moves score nodes microseconds", followed by "ok" or "FAIL expected"
+//  when an expected score was given. Aggregate throughput is printed to stderr at the end.
+// The exit code is 1 if any position was invalid or did not match its expected score.
+// Usage: batch [-t threads] [-m MB per thread] [-w] [-b book] [file]
+
+using namespace IBN5100;
+
+int main(int argc, char** argv) {
+    unsigned int numThreads = 0;
+    size_t tableBytes = TransposeTable::defaultBytes;
+    bool weak = 0;
+    std::string bookFile, inputFile;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-t" && i + 1 < argc) { numThreads = std::stoi(argv[++i]); }
+        else if (arg == "-m" && i + 1 < argc) { tableBytes = std::stoull(argv[++i]) << 20; }
+        else if (arg == "-w") { weak = 1; }
+        else if (arg == "-b" && i + 1 < argc) { bookFile = argv[++i]; }
+        else { inputFile = arg; }
+    }
+
+    std::ifstream file;
+    if (!inputFile.empty()) {
+        file.open(inputFile);
+
+        if (!file.is_open()) {
+            std::fprintf(stderr, "Could not open %s\n", inputFile.c_str());
+            return 1;
+        }
+    }
+
+    std::unique_ptr<OpeningBook> book(bookFile.empty() ? nullptr : new OpeningBook(bookFile));
+
+    if (book && !book->isValid()) {
+        std::fprintf(stderr, "%s is not an opening book of this version\n", bookFile.c_str());
+        return 1;
+    }
+
+    BatchSolver batch(numThreads, tableBytes, weak, book.get());
+
+    uint64_t positions = 0, nodes = 0, invalid = 0, failed = 0;
+    double solveTime = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    batch.run(inputFile.empty() ? std::cin : file, [&](BatchResult const &r) {
+        if (!r.valid) {
+            std::printf("%s invalid\n", r.moves.c_str());
+            std::fflush(stdout);
+            ++invalid;
+            return;
+        }
+
+        // A weak score only has to agree on the sign.
+        bool ok = !r.hasExpected || (weak ? (r.score > 0) - (r.score < 0) == (r.expected > 0) - (r.expected < 0) : r.score == r.expected);
+
+        std::printf("%s %d %llu %.0f", r.moves.c_str(), r.score, (unsigned long long) r.nodes, r.seconds*1e6);
+        if (r.hasExpected) { ok ? std::printf(" ok") : std::printf(" FAIL %d", r.expected); }
+        std::printf("\n");
+        std::fflush(stdout);
+
+        ++positions;
+        nodes += r.nodes;
+        solveTime += r.seconds;
+        failed += !ok;
+    });
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::fprintf(stderr, "%llu positions in %.3fs with %u threads: %.1f positions/s, %.0f knodes/s",
+        (unsigned long long) positions, elapsed, batch.getNumThreads(), positions/elapsed, nodes/elapsed/1000);
+    std::fprintf(stderr, ", mean %.1fus and %.0f nodes per position\n", positions ? solveTime/positions*1e6 : 0, positions ? (double) nodes/positions : 0);
+    if (invalid) { std::fprintf(stderr, "%llu invalid positions\n", (unsigned long long) invalid); }
+    if (failed) { std::fprintf(stderr, "%llu positions did not match their expected score\n", (unsigned long long) failed); }
+
+    return invalid || failed;
+};
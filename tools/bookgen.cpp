@@ -0,0 +1,163 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "../include/solver.h"
+
+// Generate an opening book holding the exact score of every unique position up to a given number of moves.
+// Positions are solved deepest first, one ply at a time, by one Solver per thread. Each finished ply is merged
+//  into the book, so the shallower plies are mostly answered by the book itself.
+// Every solved position is also appended to a checkpoint file. If the run is interrupted, running the same
+//  command again skips everything already in the book or the checkpoint.
+// With -r, only the positions following the given move sequence are generated, up to the same total number of moves.
+//  A root a few moves short of the depth makes for a small book that is quick to generate, for instance to try out the
+//  checkpointing.
+// Usage: bookgen [-d depth] [-r root moves] [-t threads] [-m MB per thread] [-c checkpoint] book
+
+using namespace IBN5100;
+
+// Enumerate the positions reachable from the root with exactly ply moves played, one per symmetric key.
+// Positions in which the game is over are not expanded.
+static std::vector<std::vector<Position>> enumerate(Position const &root, int depth) {
+    std::vector<std::vector<Position>> plies(depth + 1);
+    plies[root.getMoves()].push_back(root);
+
+    for (int ply = root.getMoves(); ply < depth; ++ply) {
+        std::unordered_set<uint64_t> seen;
+
+        for (Position const &pos : plies[ply]) {
+            for (int c = 0; c < 7; ++c) {
+                if (!pos.canPlay(c) || pos.isWin(c)) { continue; }
+
+                Position child(pos);
+                child.playCol(c);
+                if (seen.insert(child.symmetricKey()).second) { plies[ply + 1].push_back(child); }
+            }
+        }
+    }
+
+    return plies;
+}
+
+// Move the positions solved by a previous run into the book. Each checkpoint line is "key moves score".
+// A partially written last line is ignored. Returns whether the book could be written.
+static bool readCheckpoint(std::string const &filename, OpeningBook &book) {
+    std::ifstream f(filename);
+
+    unsigned long long key;
+    int moves, score;
+    while (f >> key >> moves >> score) { book.save(key, moves, score); }
+
+    return book.write();
+}
+
+int main(int argc, char** argv) {
+    int depth = 12;
+    unsigned int numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    size_t tableBytes = TransposeTable::defaultBytes;
+    std::string bookFile, checkpointFile, rootMoves;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-d" && i + 1 < argc) { depth = std::stoi(argv[++i]); }
+        else if (arg == "-t" && i + 1 < argc) { numThreads = std::max(std::stoi(argv[++i]), 1); }
+        else if (arg == "-m" && i + 1 < argc) { tableBytes = std::stoull(argv[++i]) << 20; }
+        else if (arg == "-c" && i + 1 < argc) { checkpointFile = argv[++i]; }
+        else if (arg == "-r" && i + 1 < argc) { rootMoves = argv[++i]; }
+        else { bookFile = arg; }
+    }
+
+    if (bookFile.empty() || depth < 0) {
+        std::fprintf(stderr, "Usage: %s [-d depth] [-r root moves] [-t threads] [-m MB per thread] [-c checkpoint] book\n", argv[0]);
+        return 1;
+    }
+
+    Position root;
+
+    if (root.init(rootMoves) != rootMoves.length() || (int) rootMoves.length() > depth) {
+        std::fprintf(stderr, "The root %s is not a legal, unfinished game of at most %d moves\n", rootMoves.c_str(), depth);
+        return 1;
+    }
+
+    if (checkpointFile.empty()) { checkpointFile = bookFile + ".ckpt"; }
+
+    OpeningBook book(bookFile);
+
+    // A file that is not a book of this version, such as a book in an older format, is left alone rather than replaced.
+    if (!book.isValid()) {
+        std::fprintf(stderr, "%s is not an opening book of this version\n", bookFile.c_str());
+        return 1;
+    }
+
+    if (!readCheckpoint(checkpointFile, book)) {
+        std::fprintf(stderr, "Could not write %s\n", bookFile.c_str());
+        return 1;
+    }
+
+    std::vector<std::vector<Position>> plies = enumerate(root, depth);
+
+    std::ofstream checkpoint(checkpointFile, std::ofstream::app);
+    std::mutex checkpointMutex;
+
+    // One solver per thread. They only read the book, which is never written while they are searching.
+    std::vector<std::unique_ptr<Solver>> solvers;
+    for (unsigned int i = 0; i < numThreads; ++i) { solvers.emplace_back(new Solver(&book, 1, tableBytes)); }
+
+    for (int ply = depth; ply >= root.getMoves(); --ply) {
+        // Only positions that a search can look up need to be stored: negamax is never called on a position
+        //  where the current player can win immediately.
+        std::vector<Position> todo;
+        for (Position const &pos : plies[ply]) {
+            int score;
+            if (!pos.canWinNext() && !book.get(pos.symmetricKey(), score)) { todo.push_back(pos); }
+        }
+
+        std::fprintf(stderr, "ply %d: %zu positions, %zu left to solve\n", ply, plies[ply].size(), todo.size());
+        if (todo.empty()) { continue; }
+
+        std::atomic<size_t> next{0};
+        std::vector<int> scores(todo.size());
+        auto start = std::chrono::steady_clock::now();
+
+        auto work = [&](Solver* solver) {
+            for (size_t i; (i = next++) < todo.size();) {
+                scores[i] = solver->solve(todo[i]);
+
+                std::lock_guard<std::mutex> lock(checkpointMutex);
+                checkpoint << todo[i].symmetricKey() << ' ' << todo[i].getMoves() << ' ' << scores[i] << '\n' << std::flush;
+
+                if ((i + 1)%10000 == 0) {
+                    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    std::fprintf(stderr, "ply %d: %zu/%zu solved (%.1f positions/s)\n", ply, i + 1, todo.size(), (i + 1)/elapsed.count());
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::unique_ptr<Solver> const &solver : solvers) { threads.emplace_back(work, solver.get()); }
+        for (std::thread &t : threads) { t.join(); }
+
+        for (size_t i = 0; i < todo.size(); ++i) { book.save(todo[i], scores[i]); }
+
+        // The solved positions are still in the checkpoint, so the next run picks them up.
+        if (!book.write()) {
+            std::fprintf(stderr, "Could not write %s, the solved positions are kept in %s\n", bookFile.c_str(), checkpointFile.c_str());
+            return 1;
+        }
+    }
+
+    // Everything is in the book now, so the checkpoint is no longer needed.
+    checkpoint.close();
+    std::remove(checkpointFile.c_str());
+
+    std::fprintf(stderr, "book %s: %llu positions up to %d moves\n", bookFile.c_str(), (unsigned long long) book.getNumEntries(), book.getMaxMoves());
+    return 0;
+};
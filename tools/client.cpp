@@ -0,0 +1,90 @@
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../include/solverserver.h"
+
+// Send the requests read from stdin, one per line, to a running server and print each one followed by its response,
+//  without the index, in input order. Requests are pipelined: they are all sent without waiting for responses.
+// Usage: client socket
+
+using namespace IBN5100;
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s socket\n", argv[0]);
+        return 1;
+    }
+
+    int fd = connectUnix(argv[1]);
+
+    if (fd < 0) {
+        std::fprintf(stderr, "Could not connect to %s\n", argv[1]);
+        return 1;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::mutex mutex;
+    std::vector<std::string> requests; // the server numbers requests in the order it reads them, skipping blank lines
+
+    std::thread sender([&] {
+        for (std::string line; std::getline(std::cin, line);) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(line);
+            }
+
+            line += '\n';
+            if (write(fd, line.data(), line.size()) != (ssize_t) line.size()) { break; }
+        }
+
+        // The server answers every request before closing its side, which ends the loop below.
+        shutdown(fd, SHUT_WR);
+    });
+
+    std::map<uint64_t, std::string> waiting; // responses that arrived before the responses to earlier requests
+    uint64_t next = 0;
+    std::string buffer;
+    char chunk[4096];
+
+    for (ssize_t n; (n = read(fd, chunk, sizeof(chunk))) > 0;) {
+        buffer.append(chunk, n);
+
+        size_t start = 0;
+        for (size_t end; (end = buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+            std::string response = buffer.substr(start, end - start);
+            size_t space = response.find(' ');
+            waiting[std::stoull(response.substr(0, space))] = response.substr(space);
+        }
+
+        buffer.erase(0, start);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = waiting.begin(); it != waiting.end() && it->first == next; it = waiting.erase(it), ++next) {
+            std::printf("%s%s\n", requests[next].c_str(), it->second.c_str());
+        }
+
+        std::fflush(stdout);
+    }
+
+    sender.join();
+    close(fd);
+
+    if (!waiting.empty() || next != requests.size()) {
+        std::fprintf(stderr, "The server closed the connection with %zu requests unanswered\n", requests.size() - next);
+        return 1;
+    }
+
+    return 0;
+};
@@ -0,0 +1,97 @@
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../include/solverserver.h"
+
+// Keep a pool of solvers with warm transposition tables and answer solve and analyze requests on a Unix domain socket,
+//  or on stdin and stdout when no socket is given. See SolverServer for the protocol.
+// With -p, worker i loads its table from "<snapshot>.<i>" at startup if it exists and saves it there when the server is
+//  stopped with SIGINT or SIGTERM. A file that exists but cannot be loaded, such as an unrelated file or a snapshot of
+//  another table layout, is reported and left alone.
+// Usage: server [-t threads] [-m MB per thread] [-q queue size] [-p snapshot] [-b book] [socket]
+
+using namespace IBN5100;
+
+// The server the signal handlers stop, set only while they are installed.
+static SolverServer* listening = nullptr;
+
+static void onSignal(int) { listening->stop(); }
+
+int main(int argc, char** argv) {
+    unsigned int numThreads = 0;
+    size_t tableBytes = TransposeTable::defaultBytes, queueSize = 0;
+    std::string bookFile, snapshotFile, socketPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-t" && i + 1 < argc) { numThreads = std::stoi(argv[++i]); }
+        else if (arg == "-m" && i + 1 < argc) { tableBytes = std::stoull(argv[++i]) << 20; }
+        else if (arg == "-q" && i + 1 < argc) { queueSize = std::stoull(argv[++i]); }
+        else if (arg == "-p" && i + 1 < argc) { snapshotFile = argv[++i]; }
+        else if (arg == "-b" && i + 1 < argc) { bookFile = argv[++i]; }
+        else if (arg[0] != '-' && socketPath.empty()) { socketPath = arg; }
+        else {
+            std::fprintf(stderr, "Usage: %s [-t threads] [-m MB per thread] [-q queue size] [-p snapshot] [-b book] [socket]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::unique_ptr<OpeningBook> book(bookFile.empty() ? nullptr : new OpeningBook(bookFile));
+
+    if (book && !book->isValid()) {
+        std::fprintf(stderr, "%s is not an opening book of this version\n", bookFile.c_str());
+        return 1;
+    }
+
+    SolverServer server(numThreads, tableBytes, queueSize, book.get());
+
+    std::vector<bool> saveSnapshot(server.getNumThreads(), !snapshotFile.empty());
+
+    for (unsigned int i = 0; i < server.getNumThreads() && !snapshotFile.empty(); ++i) {
+        std::string file = snapshotFile + "." + std::to_string(i);
+
+        if (!server.getSolver(i).loadTable(file) && !access(file.c_str(), F_OK)) {
+            std::fprintf(stderr, "Could not load the transposition table from %s, so it will not be saved there\n", file.c_str());
+            saveSnapshot[i] = 0;
+        }
+    }
+
+    // A client that disconnects before reading its responses must not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int status = 0;
+
+    if (socketPath.empty()) { server.serve(STDIN_FILENO, STDOUT_FILENO); }
+    else {
+        listening = &server;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+
+        std::fprintf(stderr, "Serving on %s with %u workers\n", socketPath.c_str(), server.getNumThreads());
+
+        if (!server.listen(socketPath)) {
+            std::fprintf(stderr, "Could not listen on %s\n", socketPath.c_str());
+            status = 1;
+        }
+
+        // Another signal while the snapshots are being saved ends the server as usual.
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        listening = nullptr;
+    }
+
+    for (unsigned int i = 0; i < server.getNumThreads(); ++i) {
+        if (!saveSnapshot[i]) { continue; }
+
+        std::string file = snapshotFile + "." + std::to_string(i);
+        if (!server.getSolver(i).saveTable(file)) { std::fprintf(stderr, "Could not save the transposition table to %s\n", file.c_str()); }
+    }
+
+    return status;
+};
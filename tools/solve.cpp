@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "../include/gamesession.h"
+
+// Solve positions given as move sequences, one per line on stdin, and print "moves score" for each.
+// With -a, print the score of each of the 7 columns instead, with "-" for full columns.
+// With -T, search each position for at most the given number of milliseconds and print "moves column score depth",
+//  where the column is numbered from 1 like the moves, and the score is followed by "?" if it is only an estimate.
+// With -g, each line is a game: its positions are solved in order through a GameSession, reusing the table from one move to
+//  the next, and "moves score score ..." is printed with the score of each position from the given number of moves played on,
+//  up to the end of the line or its first invalid move. Positions of the first dozen moves are only cheap with an opening book.
+// With -p, load the transposition table from a snapshot file at startup if it exists and save it there before exiting.
+//  A file that exists but cannot be loaded, such as an unrelated file or a snapshot of another table layout, is reported
+//  and left alone.
+// With -s, also print the search statistics of each position to stderr. This needs a build with IBN5100_STATS.
+// Lines that are not a legal, unfinished game are reported as invalid.
+// Usage: ibn5100 [-t threads] [-m MB] [-w] [-a] [-g from] [-T ms] [-s] [-p snapshot] [-b book]
+
+using namespace IBN5100;
+
+static void printStats(SearchStats const &stats) {
+    std::fflush(stdout); // keep the statistics after the score they belong to
+    std::fprintf(stderr, "  table: %llu probes, %llu hits (%llu exact, %llu lower, %llu upper), %llu overwrites\n",
+        (unsigned long long) stats.ttProbes, (unsigned long long) stats.ttHits, (unsigned long long) stats.exactHits,
+        (unsigned long long) stats.lowerHits, (unsigned long long) stats.upperHits, (unsigned long long) stats.ttOverwrites);
+    std::fprintf(stderr, "  exits: %llu min, %llu max, %llu threat, %llu lower bound, %llu upper bound, %llu child bound, %llu book\n",
+        (unsigned long long) stats.minExits, (unsigned long long) stats.maxExits, (unsigned long long) stats.threatExits,
+        (unsigned long long) stats.lowerExits, (unsigned long long) stats.upperExits, (unsigned long long) stats.etcExits,
+        (unsigned long long) stats.bookHits);
+
+    std::fprintf(stderr, "  cutoffs by move:");
+    for (uint64_t n : stats.cutoffsByMove) { std::fprintf(stderr, " %llu", (unsigned long long) n); }
+
+    std::fprintf(stderr, "\n  nodes by ply:");
+    for (int ply = 0; ply <= SearchStats::maxCells; ++ply) {
+        if (stats.nodesByPly[ply]) { std::fprintf(stderr, " %d:%llu", ply, (unsigned long long) stats.nodesByPly[ply]); }
+    }
+
+    std::fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv) {
+    unsigned int numThreads = 1;
+    size_t tableBytes = TransposeTable::defaultBytes;
+    bool weak = 0, analyze = 0, stats = 0;
+    long timeLimit = -1, gameFrom = -1;
+    std::string bookFile, snapshotFile;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-t" && i + 1 < argc) { numThreads = std::stoi(argv[++i]); }
+        else if (arg == "-m" && i + 1 < argc) { tableBytes = std::stoull(argv[++i]) << 20; }
+        else if (arg == "-w") { weak = 1; }
+        else if (arg == "-a") { analyze = 1; }
+        else if (arg == "-g" && i + 1 < argc) { gameFrom = std::stol(argv[++i]); }
+        else if (arg == "-s") { stats = 1; }
+        else if (arg == "-p" && i + 1 < argc) { snapshotFile = argv[++i]; }
+        else if (arg == "-T" && i + 1 < argc) { timeLimit = std::stol(argv[++i]); }
+        else if (arg == "-b" && i + 1 < argc) { bookFile = argv[++i]; }
+        else {
+            std::fprintf(stderr, "Usage: %s [-t threads] [-m MB] [-w] [-a] [-g from] [-T ms] [-s] [-p snapshot] [-b book]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (stats && !statsEnabled) {
+        std::fprintf(stderr, "%s was built without IBN5100_STATS, so there are no statistics to print\n", argv[0]);
+        return 1;
+    }
+
+    OpeningBook* book = bookFile.empty() ? nullptr : new OpeningBook(bookFile);
+
+    if (book && !book->isValid()) {
+        std::fprintf(stderr, "%s is not an opening book of this version\n", bookFile.c_str());
+        return 1;
+    }
+
+    Solver solver(book, numThreads, tableBytes);
+    bool saveSnapshot = !snapshotFile.empty();
+
+    if (saveSnapshot && !solver.loadTable(snapshotFile) && !access(snapshotFile.c_str(), F_OK)) {
+        std::fprintf(stderr, "Could not load the transposition table from %s, so it will not be saved there\n", snapshotFile.c_str());
+        saveSnapshot = 0;
+    }
+
+    for (std::string line; std::getline(std::cin, line);) {
+        Position pos;
+
+        if (gameFrom >= 0) {
+            GameSession session(solver, line.substr(0, gameFrom));
+            std::printf("%s", line.c_str());
+
+            if (session.getMoves().length() == std::min<size_t>(gameFrom, line.length())) {
+                std::printf(" %d", session.solve(weak));
+
+                for (size_t i = gameFrom; i < line.length() && session.play(line[i] - '1'); ++i) {
+                    std::printf(" %d", session.solve(weak));
+                }
+            }
+
+            if (session.getMoves() != line) { std::printf(" invalid"); }
+            std::printf("\n");
+        } else if (pos.init(line) != line.length()) { std::printf("%s invalid\n", line.c_str()); }
+        else if (timeLimit >= 0) {
+            Evaluation eval = solver.evaluate(pos, std::chrono::milliseconds(timeLimit));
+            std::printf("%s %d %d%s %d\n", line.c_str(), eval.move + 1, eval.score, eval.proven ? "" : "?", eval.depth);
+        } else if (!analyze) {
+            std::printf("%s %d\n", line.c_str(), solver.solve(pos, weak));
+            if (stats) { printStats(solver.getSearchStats()); }
+        } else {
+            std::printf("%s", line.c_str());
+
+            for (int score : solver.analyze(pos, weak)) {
+                if (score == Solver::invalidMove) { std::printf(" -"); }
+                else { std::printf(" %d", score); }
+            }
+
+            std::printf("\n");
+        }
+
+        std::fflush(stdout);
+    }
+
+    if (saveSnapshot && !solver.saveTable(snapshotFile)) {
+        std::fprintf(stderr, "Could not save the transposition table to %s\n", snapshotFile.c_str());
+    }
+
+    delete book;
+    return 0;
+};